@@ -1,46 +1,265 @@
 #ifndef PID_H
 #define PID_H
 
-class PID {
+#include <math.h>
+
+/*
+* Gain policies supply Kp(), Ki() and Kd() to BasicPID.
+*
+* RuntimeGains stores the coefficients in the controller so they can be set
+* through Init(). A policy with static constexpr accessors fixes the gains at
+* compile time instead, e.g.
+*
+*   struct SteeringGains {
+*     static constexpr double kp() { return 0.237662; }
+*     static constexpr double ki() { return 0.000671427; }
+*     static constexpr double kd() { return 2.75795; }
+*   };
+*   BasicPID<double, SteeringGains> pid;
+*/
+template <typename Scalar>
+struct RuntimeGains {
+  /*
+  * Coefficients
+  */
+  Scalar Kp;
+  Scalar Ki;
+  Scalar Kd;
+
+  RuntimeGains() : Kp(0), Ki(0), Kd(0) {}
+
+  Scalar kp() const { return Kp; }
+  Scalar ki() const { return Ki; }
+  Scalar kd() const { return Kd; }
+
+  void SetGains(Scalar Kp, Scalar Ki, Scalar Kd) {
+    this->Kp = Kp;
+    this->Ki = Ki;
+    this->Kd = Kd;
+  }
+};
+
+/*
+* Header-only PID controller. Everything is inline and non-virtual, so with a
+* compile-time gain policy the update and output fold into straight-line code.
+*/
+template <typename Scalar, typename GainPolicy = RuntimeGains<Scalar> >
+class BasicPID : public GainPolicy {
  public:
   /*
   * Errors
   */
-  double p_error;
-  double i_error;
-  double d_error;
+  Scalar p_error;
+  Scalar i_error;
+  Scalar d_error;
 
   /*
-  * Coefficients
-  */ 
-  double Kp;
-  double Ki;
-  double Kd;
+  * Sample period the gains were tuned at, in the same unit as the dt passed
+  * to UpdateError(cte, dt).
+  */
+  Scalar sample_period;
+
+  /*
+  * Longest dt, in sample periods, UpdateError(cte, dt) scales by. A longer
+  * one (a pause or a reconnect) is treated as a single period rather than
+  * integrating the cte over the whole gap.
+  */
+  Scalar max_steps;
+
+  /*
+  * Output limits, applied only once SetOutputLimits() has been called.
+  */
+  bool limited;
+  Scalar output_min;
+  Scalar output_max;
+
+  /*
+  * First-order low-pass filter on the derivative, applied only once
+  * SetDerivativeFilter() has been called. d_error holds the filtered value:
+  * d_error = d_filter_a * d_error + d_filter_b * (cte - p_error).
+  */
+  bool d_filtered;
+  Scalar d_filter_a;
+  Scalar d_filter_b;
+
+  /*
+  * Saturation counters. saturation_count is the number of updates whose
+  * unclamped output was outside the limits, windup_count the number of those
+  * where integration was held back to avoid winding up.
+  */
+  unsigned long saturation_count;
+  unsigned long windup_count;
 
   /*
   * Constructor
   */
-  PID();
+  BasicPID()
+      : p_error(0), i_error(0), d_error(0), sample_period(1), max_steps(5),
+        limited(false), output_min(0), output_max(0), d_filtered(false),
+        d_filter_a(0), d_filter_b(1), saturation_count(0), windup_count(0) {}
 
   /*
-  * Destructor.
+  * Initialize PID. Only available with RuntimeGains.
   */
-  virtual ~PID();
+  void Init(Scalar Kp, Scalar Ki, Scalar Kd) {
+    this->SetGains(Kp, Ki, Kd);
+    Init();
+  }
 
   /*
-  * Initialize PID.
+  * Change the gains of a running controller, keeping its error state. The
+  * integral is rescaled so its contribution Ki * i_error doesn't jump
+  * (bumpless transfer); it is left as is when either Ki is zero or Ki is
+  * unchanged, so calling this every step with the same gains is a no-op.
+  * Only available with RuntimeGains.
   */
-  void Init(double Kp, double Ki, double Kd);
+  void UpdateGains(Scalar Kp, Scalar Ki, Scalar Kd) {
+    if (this->ki() != 0 && Ki != 0 && Ki != this->ki()) {
+      i_error = i_error * this->ki() / Ki;
+    }
+    this->SetGains(Kp, Ki, Kd);
+  }
+
+  /*
+  * Reset the error state and counters, keeping gains and limits.
+  */
+  void Init() {
+    p_error = 0;
+    i_error = 0;
+    d_error = 0;
+    saturation_count = 0;
+    windup_count = 0;
+  }
+
+  /*
+  * Clamp TotalError() to [min, max] and stop integrating while the output
+  * is saturated (conditional-integration anti-windup).
+  */
+  void SetOutputLimits(Scalar min, Scalar max) {
+    limited = true;
+    output_min = min;
+    output_max = max;
+  }
+
+  /*
+  * Low-pass filter the derivative with the given cutoff frequency. The
+  * coefficients are computed here, once, from sample_period (which must be
+  * in seconds and set beforehand), so each update costs two multiply-adds.
+  * A cutoff of zero or less removes the filter.
+  */
+  void SetDerivativeFilter(double cutoff_hz) {
+    d_filtered = cutoff_hz > 0;
+    if (!d_filtered) {
+      d_filter_a = 0;
+      d_filter_b = 1;
+      return;
+    }
+    const double period = static_cast<double>(sample_period);
+    const double tau = 1.0 / (2.0 * M_PI * cutoff_hz);
+    d_filter_a = Scalar(tau / (tau + period));
+    d_filter_b = Scalar(period / (tau + period));
+  }
 
   /*
   * Update the PID error variables given cross track error.
   */
-  void UpdateError(double cte);
+  void UpdateError(Scalar cte) {
+    UpdateDerivative(cte - p_error);
+    p_error = cte;
+    Integrate(cte);
+  }
+
+  /*
+  * Update the PID error variables given cross track error and the time
+  * elapsed since the previous update. The integral and derivative are scaled
+  * by dt / sample_period, so at a constant dt == sample_period this matches
+  * UpdateError(cte) exactly. The derivative filter keeps the coefficients
+  * computed for sample_period. A non-positive dt (first sample, repeated
+  * timestamp) or one over max_steps periods is treated as one nominal
+  * period.
+  */
+  void UpdateError(Scalar cte, Scalar dt) {
+    const Scalar steps = dt / sample_period;
+    if (!(dt > 0) || steps > max_steps) {
+      UpdateError(cte);
+      return;
+    }
+    UpdateDerivative((cte - p_error) / steps);
+    p_error = cte;
+    Integrate(cte * steps);
+  }
+
+  /*
+  * Add increment (cte times periods) to the integral outside an update,
+  * e.g. for samples that were never controlled on, with the same
+  * anti-windup as an update. It isn't counted in saturation_count or
+  * windup_count: the update that follows counts the step.
+  */
+  void AddIntegral(Scalar increment) { Integrate(increment, false); }
 
   /*
-  * Calculate the total PID error.
+  * Set the sample period used by UpdateError(cte, dt).
   */
-  double TotalError();
+  void SetSamplePeriod(Scalar period) { sample_period = period; }
+
+  /*
+  * Calculate the total PID error, clamped to the output limits if set.
+  */
+  Scalar TotalError() const {
+    const Scalar total = UnclampedError();
+    if (!limited) {
+      return total;
+    }
+    if (total > output_max) {
+      return output_max;
+    }
+    if (total < output_min) {
+      return output_min;
+    }
+    return total;
+  }
+
+ private:
+  void UpdateDerivative(Scalar raw) {
+    if (d_filtered) {
+      d_error = d_filter_a * d_error + d_filter_b * raw;
+    } else {
+      d_error = raw;
+    }
+  }
+
+  Scalar UnclampedError() const {
+    return (-this->kp() * p_error - this->kd() * d_error -
+            this->ki() * i_error);
+  }
+
+  // Adds increment to the integral unless the output is saturated and the
+  // increment would drive it further past the limit. count says whether
+  // this is an update for the saturation counters.
+  void Integrate(Scalar increment, bool count = true) {
+    const Scalar previous = i_error;
+    i_error += increment;
+    if (!limited) {
+      return;
+    }
+    const Scalar total = UnclampedError();
+    const bool high = total > output_max;
+    const bool low = total < output_min;
+    if (!high && !low) {
+      return;
+    }
+    saturation_count += count;
+    const Scalar push = -this->ki() * increment;
+    if ((high && push > 0) || (low && push < 0)) {
+      i_error = previous;
+      windup_count += count;
+    }
+  }
 };
 
+/*
+* The run-time tunable controller used throughout the project.
+*/
+typedef BasicPID<double> PID;
+
 #endif /* PID_H */
@@ -0,0 +1,159 @@
+#ifndef PID_BANK_H
+#define PID_BANK_H
+
+#include <cstddef>
+#include <vector>
+
+/*
+* Structure-of-arrays bank of PID controllers. Gains and error state for
+* every controller live in contiguous arrays so one call steps the whole
+* bank and the inner loops auto-vectorize. Results match BasicPID<Scalar>
+* UpdateError and TotalError bit for bit. float halves the memory traffic
+* and doubles the vector width compared to double.
+*/
+template <typename Scalar>
+class BasicPIDBank {
+ public:
+  /*
+  * Errors
+  */
+  std::vector<Scalar> p_error;
+  std::vector<Scalar> i_error;
+  std::vector<Scalar> d_error;
+
+  /*
+  * Coefficients
+  */
+  std::vector<Scalar> Kp;
+  std::vector<Scalar> Ki;
+  std::vector<Scalar> Kd;
+
+  /*
+  * Append a controller and return its index.
+  */
+  size_t Add(Scalar Kp, Scalar Ki, Scalar Kd) {
+    this->Kp.push_back(Kp);
+    this->Ki.push_back(Ki);
+    this->Kd.push_back(Kd);
+
+    p_error.push_back(0);
+    i_error.push_back(0);
+    d_error.push_back(0);
+    return this->Kp.size() - 1;
+  }
+
+  /*
+  * Re-initialize controller i, zeroing its error state.
+  */
+  void Init(size_t i, Scalar Kp, Scalar Ki, Scalar Kd) {
+    this->Kp[i] = Kp;
+    this->Ki[i] = Ki;
+    this->Kd[i] = Kd;
+
+    p_error[i] = 0;
+    i_error[i] = 0;
+    d_error[i] = 0;
+  }
+
+  /*
+  * Number of controllers in the bank.
+  */
+  size_t size() const { return Kp.size(); }
+
+  /*
+  * Update every controller from cte[0..size()).
+  */
+  void UpdateError(const Scalar *cte) {
+    UpdateKernel(size(), cte, p_error.data(), i_error.data(),
+                 d_error.data());
+  }
+
+  /*
+  * Write every controller's total error to out[0..size()).
+  */
+  void TotalError(Scalar *out) const {
+    TotalKernel(size(), Kp.data(), Ki.data(), Kd.data(), p_error.data(),
+                i_error.data(), d_error.data(), out);
+  }
+
+  /*
+  * UpdateError followed by TotalError in a single pass over the arrays.
+  */
+  void Step(const Scalar *cte, Scalar *out) {
+    StepKernel(size(), Kp.data(), Ki.data(), Kd.data(), cte, p_error.data(),
+               i_error.data(), d_error.data(), out);
+  }
+
+ private:
+  // The kernels take their arrays as __restrict__ parameters so the compiler
+  // can prove they don't alias and vectorize the loops. The arithmetic is
+  // kept in the same order as BasicPID so results stay identical.
+
+  static void UpdateKernel(size_t n, const Scalar *__restrict__ cte,
+                           Scalar *__restrict__ p, Scalar *__restrict__ i,
+                           Scalar *__restrict__ d) {
+    for (size_t k = 0; k < n; ++k) {
+      i[k] += cte[k];
+      d[k] = cte[k] - p[k];
+      p[k] = cte[k];
+    }
+  }
+
+  static void TotalKernel(size_t n, const Scalar *__restrict__ kp,
+                          const Scalar *__restrict__ ki,
+                          const Scalar *__restrict__ kd,
+                          const Scalar *__restrict__ p,
+                          const Scalar *__restrict__ i,
+                          const Scalar *__restrict__ d,
+                          Scalar *__restrict__ out) {
+    for (size_t k = 0; k < n; ++k) {
+      out[k] = -kp[k] * p[k] - kd[k] * d[k] - ki[k] * i[k];
+    }
+  }
+
+  static void StepKernel(size_t n, const Scalar *__restrict__ kp,
+                         const Scalar *__restrict__ ki,
+                         const Scalar *__restrict__ kd,
+                         const Scalar *__restrict__ cte,
+                         Scalar *__restrict__ p, Scalar *__restrict__ i,
+                         Scalar *__restrict__ d, Scalar *__restrict__ out) {
+    for (size_t k = 0; k < n; ++k) {
+      const Scalar i_k = i[k] + cte[k];
+      const Scalar d_k = cte[k] - p[k];
+      i[k] = i_k;
+      d[k] = d_k;
+      p[k] = cte[k];
+      out[k] = -kp[k] * cte[k] - kd[k] * d_k - ki[k] * i_k;
+    }
+  }
+};
+
+typedef BasicPIDBank<double> PIDBank;
+
+/*
+* Evaluate n candidate gain sets against one error state. gains holds n
+* packed (Kp, Ki, Kd) triples; out[k] receives the unclamped TotalError() a
+* controller with triple k and this error state would return. The loop
+* vectorizes, so a tuning sweep can score many candidates per step.
+*/
+template <typename Scalar>
+void EvaluateGainCandidates(Scalar p_error, Scalar i_error, Scalar d_error,
+                            const Scalar *__restrict__ gains, size_t n,
+                            Scalar *__restrict__ out) {
+  for (size_t k = 0; k < n; ++k) {
+    const Scalar *g = gains + 3 * k;
+    out[k] = -g[0] * p_error - g[2] * d_error - g[1] * i_error;
+  }
+}
+
+/*
+* Same as above, taking the error state from an existing controller.
+*/
+template <typename Controller, typename Scalar>
+void EvaluateGainCandidates(const Controller &pid, const Scalar *gains,
+                            size_t n, Scalar *out) {
+  EvaluateGainCandidates<Scalar>(pid.p_error, pid.i_error, pid.d_error, gains,
+                                 n, out);
+}
+
+#endif /* PID_BANK_H */
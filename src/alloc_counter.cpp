@@ -0,0 +1,51 @@
+#include "alloc_counter.h"
+
+#ifdef PID_COUNT_ALLOCATIONS
+
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+thread_local uint64_t allocation_count = 0;
+
+void *CountedAllocate(size_t size) {
+  ++allocation_count;
+  void *p = std::malloc(size ? size : 1);
+  if (!p) {
+    throw std::bad_alloc();
+  }
+  return p;
+}
+
+}  // namespace
+
+uint64_t AllocationCount() { return allocation_count; }
+
+void *operator new(size_t size) { return CountedAllocate(size); }
+
+void *operator new[](size_t size) { return CountedAllocate(size); }
+
+void *operator new(size_t size, const std::nothrow_t &) noexcept {
+  ++allocation_count;
+  return std::malloc(size ? size : 1);
+}
+
+void *operator new[](size_t size, const std::nothrow_t &) noexcept {
+  ++allocation_count;
+  return std::malloc(size ? size : 1);
+}
+
+void operator delete(void *p) noexcept { std::free(p); }
+
+void operator delete[](void *p) noexcept { std::free(p); }
+
+void operator delete(void *p, const std::nothrow_t &) noexcept {
+  std::free(p);
+}
+
+void operator delete[](void *p, const std::nothrow_t &) noexcept {
+  std::free(p);
+}
+
+#endif  // PID_COUNT_ALLOCATIONS
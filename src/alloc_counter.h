@@ -0,0 +1,48 @@
+#ifndef ALLOC_COUNTER_H
+#define ALLOC_COUNTER_H
+
+#include <cstdint>
+
+/*
+* Global heap allocation counting, compiled in with
+* -DPID_COUNT_ALLOCATIONS=ON. The build then replaces the global operator
+* new/delete with versions that count calls per thread. Without it the
+* count is always 0 and costs nothing.
+*/
+#ifdef PID_COUNT_ALLOCATIONS
+const bool kCountingAllocations = true;
+
+/*
+* Number of operator new calls made by the calling thread so far.
+*/
+uint64_t AllocationCount();
+#else
+const bool kCountingAllocations = false;
+
+inline uint64_t AllocationCount() { return 0; }
+#endif
+
+/*
+* Adds the allocations made during its lifetime to *total, and counts the
+* scope in *allocating_scopes if there were any.
+*/
+class AllocationProbe {
+ public:
+  AllocationProbe(uint64_t *total, uint64_t *allocating_scopes)
+      : total_(total),
+        allocating_scopes_(allocating_scopes),
+        start_(AllocationCount()) {}
+
+  ~AllocationProbe() {
+    const uint64_t n = AllocationCount() - start_;
+    *total_ += n;
+    *allocating_scopes_ += n != 0;
+  }
+
+ private:
+  uint64_t *total_;
+  uint64_t *allocating_scopes_;
+  uint64_t start_;
+};
+
+#endif /* ALLOC_COUNTER_H */
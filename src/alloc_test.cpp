@@ -0,0 +1,124 @@
+// Checks that the control path makes no heap allocations once warmed up.
+//
+// usage: pid_alloc_test [frames]
+//
+// Built with PID_COUNT_ALLOCATIONS, so every operator new is counted. Each
+// frame goes through what onMessage does for it: ClassifyFrame,
+// DecodeTelemetry, CarPipeline::Step with a live-tunable gain schedule and
+// WriteSteerReply, and the same through the binary protocol. Frames with
+// and without a camera image, manual frames and retuned schedules are
+// mixed in. Exits non-zero if any frame after the warm-up allocates.
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "alloc_counter.h"
+#include "bench.h"
+#include "binary_protocol.h"
+#include "connection.h"
+#include "control_pipeline.h"
+#include "socketio.h"
+
+namespace {
+
+const long kWarmUp = 100;
+
+void InitPipeline(CarPipeline *pipeline, Seqlock<GainSchedule> *tuning) {
+  PID &pid = pipeline->steering.pid;
+  pid.Init(0.237662, 0.000671427, 2.75795);
+  pipeline->steering.schedule.Add(0.0, pid.Kp, pid.Ki, pid.Kd);
+  pipeline->steering.tuning = tuning;
+  pipeline->throttle.pid.Init(0.3, 0, 0.5);
+  pid.SetOutputLimits(-1.0, 1.0);
+  pipeline->throttle.pid.SetOutputLimits(-1.0, 1.0);
+  pid.SetSamplePeriod(0.05);
+  pipeline->throttle.pid.SetSamplePeriod(0.05);
+  pid.SetDerivativeFilter(5.0);
+}
+
+// Handles one text frame the way onMessage does. Returns false if a
+// telemetry frame failed to decode.
+bool HandleText(const std::string &frame, CarPipeline *pipeline,
+                char *reply, size_t capacity) {
+  Slice payload;
+  switch (ClassifyFrame(frame.data(), frame.size(), &payload)) {
+    case kTelemetryFrame: {
+      Telemetry t = Telemetry();
+      if (DecodeTelemetry(payload, &t) != kDecodeOk) {
+        return false;
+      }
+      t.dt = 0.05;
+      Consume(WriteSteerReply(pipeline->Step(t), reply, capacity));
+      return true;
+    }
+    case kManualFrame:
+      Consume(reply);
+      return true;
+    default:
+      return true;
+  }
+}
+
+bool HandleBinary(long k, CarPipeline *pipeline, char *buffer,
+                  size_t capacity) {
+  const size_t length = WriteBinaryTelemetry(
+      SampleTelemetry(k), static_cast<uint32_t>(k), buffer, capacity);
+  Telemetry t = Telemetry();
+  uint32_t sequence;
+  if (DecodeBinaryTelemetry(buffer, length, &t, &sequence) != kDecodeOk) {
+    return false;
+  }
+  t.dt = 0.05;
+  Consume(WriteBinaryCommand(pipeline->Step(t), sequence, buffer, capacity));
+  return true;
+}
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+  const long frames = Iterations(argc, argv, 10000);
+
+  std::vector<std::string> inputs;
+  for (int k = 0; k < 32; ++k) {
+    inputs.push_back(TelemetryFrame(k, 0));
+    inputs.push_back(TelemetryFrame(k, 4096));
+  }
+  inputs.push_back("42/sim,[\"telemetry\",{\"cte\":0.5,\"speed\":31,"
+                   "\"steering_angle\":1}]");
+  inputs.push_back("42[\"telemetry\",null]");
+
+  Seqlock<GainSchedule> tuning;
+  GainSchedule retuned;
+  retuned.Add(0.0, 0.2, 0.0005, 2.5);
+  retuned.Add(40.0, 0.15, 0.0004, 2.0);
+  CarPipeline pipeline;
+  InitPipeline(&pipeline, &tuning);
+
+  char reply[Connection::kReplyCapacity];
+  uint64_t allocations = 0, allocating_frames = 0;
+  long failures = 0;
+  for (long k = 0; k < kWarmUp + frames; ++k) {
+    if (k == kWarmUp) {
+      allocations = 0;
+      allocating_frames = 0;
+    }
+    // a schedule edit published by the file watcher
+    if (k % 1000 == 500) {
+      tuning.Store(retuned);
+    }
+    AllocationProbe probe(&allocations, &allocating_frames);
+    if (!HandleText(inputs[k % inputs.size()], &pipeline, reply,
+                    sizeof(reply)) ||
+        !HandleBinary(k, &pipeline, reply, sizeof(reply))) {
+      ++failures;
+    }
+  }
+
+  std::printf("%llu heap allocations in %llu of %ld frames after warm-up, "
+              "%ld frames failed to decode\n",
+              static_cast<unsigned long long>(allocations),
+              static_cast<unsigned long long>(allocating_frames), frames,
+              failures);
+  return allocations == 0 && failures == 0 ? 0 : 1;
+}
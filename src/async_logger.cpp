@@ -0,0 +1,81 @@
+#include "async_logger.h"
+#include <chrono>
+#include "log.h"
+#include "socketio.h"
+
+AsyncLogger::AsyncLogger(std::ostream *out)
+    : out_(out), dropped_(0), stop_(false) {
+  // ERROR is the highest level, so if it is compiled out nothing can log
+  if (PID_LOG_ENABLED(ERROR)) {
+    thread_ = std::thread(&AsyncLogger::Run, this);
+  }
+}
+
+AsyncLogger::~AsyncLogger() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_.store(true, std::memory_order_release);
+  }
+  wake_.notify_one();
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+}
+
+void AsyncLogger::Run() {
+  uint64_t reported = 0;
+  int idle_sleep_ms = 1;
+  while (true) {
+    // read stop_ before draining so nothing logged before the destructor
+    // ran is left behind
+    const bool stopping = stop_.load(std::memory_order_acquire);
+    LogRecord record;
+    bool wrote = false;
+    while (ring_.TryPop(&record)) {
+      Write(record);
+      wrote = true;
+    }
+    const uint64_t dropped = dropped_.load(std::memory_order_relaxed);
+    if (dropped != reported) {
+      *out_ << "(" << dropped - reported << " log records dropped)\n";
+      reported = dropped;
+      wrote = true;
+    }
+    if (wrote) {
+      out_->flush();
+    }
+    if (stopping) {
+      break;
+    }
+    if (wrote) {
+      idle_sleep_ms = 1;
+      continue;
+    }
+    // back off while idle; the destructor cuts the wait short
+    std::unique_lock<std::mutex> lock(mutex_);
+    wake_.wait_for(lock, std::chrono::milliseconds(idle_sleep_ms), [this]() {
+      return stop_.load(std::memory_order_acquire);
+    });
+    if (idle_sleep_ms < kMaxIdleSleepMs) {
+      idle_sleep_ms *= 2;
+    }
+  }
+}
+
+void AsyncLogger::Write(const LogRecord &record) {
+  switch (record.type) {
+    case kControlRecord:
+      *out_ << "CTE: " << record.a << " Steering Value: " << record.b << '\n';
+      break;
+    case kSteerRecord: {
+      Command c;
+      c.steering_angle = record.a;
+      c.throttle = record.b;
+      char msg[128];
+      const size_t length = WriteSteerReply(c, msg, sizeof(msg));
+      out_->write(msg, length);
+      *out_ << '\n';
+      break;
+    }
+  }
+}
@@ -0,0 +1,84 @@
+#ifndef ASYNC_LOGGER_H
+#define ASYNC_LOGGER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <thread>
+#include "spsc_ring.h"
+
+/*
+* Kinds of record the control thread can log.
+*/
+enum LogRecordType {
+  // CTE: <a> Steering Value: <b>
+  kControlRecord,
+  // the socket.io steer frame for steering angle <a> and throttle <b>
+  kSteerRecord,
+};
+
+/*
+* Fixed-size log record. Only the raw values are captured; all formatting
+* happens on the logger thread.
+*/
+struct LogRecord {
+  LogRecordType type;
+  double a;
+  double b;
+};
+
+/*
+* Moves console logging off the control thread. Log() copies a record into
+* a lock-free ring and returns; a background thread formats the records and
+* writes them to the stream, flushing once per batch rather than once per
+* line. When the ring is full records are dropped and counted instead of
+* blocking the producer, and the logger thread reports how many were lost.
+* While the ring stays empty the logger thread polls less and less often,
+* down to every kMaxIdleSleepMs; Log() never has to wake it. When the build
+* compiles every log level out (PID_LOG_LEVEL=NONE) no thread is started.
+*
+* Log() must only be called from one thread.
+*/
+class AsyncLogger {
+ public:
+  explicit AsyncLogger(std::ostream *out);
+  ~AsyncLogger();
+
+  void Log(LogRecordType type, double a, double b) {
+    const LogRecord record = {type, a, b};
+    if (!ring_.TryPush(record)) {
+      dropped_.store(dropped_.load(std::memory_order_relaxed) + 1,
+                     std::memory_order_relaxed);
+    }
+  }
+
+  /*
+  * Records dropped so far because the ring was full.
+  */
+  uint64_t dropped() const {
+    return dropped_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  AsyncLogger(const AsyncLogger &);
+  AsyncLogger &operator=(const AsyncLogger &);
+
+  static const size_t kCapacity = 4096;
+  static const int kMaxIdleSleepMs = 64;
+
+  void Run();
+  void Write(const LogRecord &record);
+
+  std::ostream *out_;
+  SpscRing<LogRecord, kCapacity> ring_;
+  std::atomic<uint64_t> dropped_;
+  std::atomic<bool> stop_;
+  // wakes an idle logger thread for shutdown
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  std::thread thread_;
+};
+
+#endif /* ASYNC_LOGGER_H */
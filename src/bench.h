@@ -0,0 +1,111 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include "telemetry.h"
+
+/*
+* Helpers shared by the benchmark executables.
+*/
+
+/*
+* Seconds taken by fn(), best of repetitions runs so a stray context switch
+* doesn't skew the result.
+*/
+template <typename Fn>
+double BestSeconds(Fn fn, int repetitions = 5) {
+  double best = 0;
+  for (int k = 0; k < repetitions; ++k) {
+    const std::chrono::steady_clock::time_point start =
+        std::chrono::steady_clock::now();
+    fn();
+    const double seconds = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start).count();
+    if (k == 0 || seconds < best) {
+      best = seconds;
+    }
+  }
+  return best;
+}
+
+/*
+* Keep value, and the work that produced it, from being optimized away.
+*/
+template <typename T>
+void Consume(const T &value) {
+  asm volatile("" : : "r"(&value) : "memory");
+}
+
+/*
+* The iteration count from argv[1], or fallback. Lets ctest run a benchmark
+* briefly as a smoke test.
+*/
+inline long Iterations(int argc, char *argv[], long fallback) {
+  return argc > 1 ? std::atol(argv[1]) : fallback;
+}
+
+/*
+* Deterministic telemetry sample k: cte in [-2, 2) m, speed in [30, 45) mph
+* and steering angle in [-25, 25) degrees, varying from sample to sample.
+* dt is 0.
+*/
+inline Telemetry SampleTelemetry(long k) {
+  Telemetry t;
+  t.cte = ((k * 7919) % 4000 - 2000) / 1000.0;
+  t.speed = 30 + (k * 104729 % 1500) / 100.0;
+  t.angle = ((k * 31) % 5000 - 2500) / 100.0;
+  t.dt = 0;
+  return t;
+}
+
+/*
+* Sample k as the stock simulator sends it: a socket.io telemetry frame with
+* quoted four-decimal fields, followed, if image_bytes isn't 0, by a base64
+* camera image of that length.
+*/
+inline std::string TelemetryFrame(long k, size_t image_bytes) {
+  const Telemetry t = SampleTelemetry(k);
+  char fields[160];
+  std::snprintf(fields, sizeof(fields),
+                "42[\"telemetry\",{\"cte\":\"%.4f\",\"speed\":\"%.4f\","
+                "\"steering_angle\":\"%.4f\",\"throttle\":\"0.3000\"",
+                t.cte, t.speed, t.angle);
+  std::string frame = fields;
+  if (image_bytes) {
+    static const char kBase64[] =
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    frame += ",\"image\":\"";
+    for (size_t b = 0; b < image_bytes; ++b) {
+      frame += kBase64[(b * 37 + k) % 64];
+    }
+    frame += '"';
+  }
+  return frame + "}]";
+}
+
+/*
+* The frames the socket.io benchmarks time: 64 distinct telemetry frames
+* without and with a camera image, and the manual-mode frame.
+*/
+struct SimulatorFrames {
+  // a 320x160 JPEG from the simulator's camera is about 16 KB in base64
+  static const size_t kImageBytes = 16384;
+
+  std::vector<std::string> telemetry;
+  std::vector<std::string> image;
+  std::vector<std::string> manual;
+
+  SimulatorFrames() {
+    for (long k = 0; k < 64; ++k) {
+      telemetry.push_back(TelemetryFrame(k, 0));
+      image.push_back(TelemetryFrame(k, kImageBytes));
+    }
+    manual.push_back("42[\"telemetry\",null]");
+  }
+};
+
+#endif /* BENCH_H */
@@ -0,0 +1,123 @@
+#include "binary_protocol.h"
+#include <math.h>
+#include <cstring>
+
+namespace {
+
+// Byte-wise loads and stores keep the wire format little-endian whatever the
+// host byte order, and are safe for unaligned receive buffers.
+
+void Put16(char *out, uint16_t v) {
+  out[0] = static_cast<char>(v);
+  out[1] = static_cast<char>(v >> 8);
+}
+
+void Put32(char *out, uint32_t v) {
+  for (int k = 0; k < 4; ++k) {
+    out[k] = static_cast<char>(v >> (8 * k));
+  }
+}
+
+void PutDouble(char *out, double x) {
+  uint64_t v;
+  std::memcpy(&v, &x, sizeof(v));
+  for (int k = 0; k < 8; ++k) {
+    out[k] = static_cast<char>(v >> (8 * k));
+  }
+}
+
+uint16_t Get16(const char *in) {
+  return static_cast<uint16_t>(static_cast<unsigned char>(in[0]) |
+                               static_cast<unsigned char>(in[1]) << 8);
+}
+
+uint32_t Get32(const char *in) {
+  uint32_t v = 0;
+  for (int k = 0; k < 4; ++k) {
+    v |= static_cast<uint32_t>(static_cast<unsigned char>(in[k])) << (8 * k);
+  }
+  return v;
+}
+
+double GetDouble(const char *in) {
+  uint64_t v = 0;
+  for (int k = 0; k < 8; ++k) {
+    v |= static_cast<uint64_t>(static_cast<unsigned char>(in[k])) << (8 * k);
+  }
+  double x;
+  std::memcpy(&x, &v, sizeof(x));
+  return x;
+}
+
+void PutHeader(char *out, BinaryFrameType type, uint32_t sequence) {
+  Put32(out, kBinaryProtocolMagic);
+  Put16(out + 4, kBinaryProtocolVersion);
+  Put16(out + 6, static_cast<uint16_t>(type));
+  Put32(out + 8, sequence);
+  Put32(out + 12, 0);
+}
+
+bool CheckHeader(const char *data, size_t length, BinaryFrameType type,
+                 size_t size, uint32_t *sequence) {
+  if (length != size || Get32(data) != kBinaryProtocolMagic ||
+      Get16(data + 4) != kBinaryProtocolVersion || Get16(data + 6) != type) {
+    return false;
+  }
+  *sequence = Get32(data + 8);
+  return true;
+}
+
+}  // namespace
+
+DecodeStatus DecodeBinaryTelemetry(const char *data, size_t length,
+                                   Telemetry *t, uint32_t *sequence) {
+  if (!CheckHeader(data, length, kBinaryTelemetry, kBinaryTelemetrySize,
+                   sequence)) {
+    return kDecodeMalformed;
+  }
+  const char *body = data + kBinaryHeaderSize;
+  const double cte = GetDouble(body);
+  const double speed = GetDouble(body + 8);
+  const double angle = GetDouble(body + 16);
+  if (!isfinite(cte) || !isfinite(speed) || !isfinite(angle)) {
+    return kDecodeOutOfRange;
+  }
+  t->cte = cte;
+  t->speed = speed;
+  t->angle = angle;
+  return kDecodeOk;
+}
+
+size_t WriteBinaryCommand(const Command &c, uint32_t sequence, char *out,
+                          size_t capacity) {
+  if (capacity < kBinaryCommandSize) {
+    return 0;
+  }
+  PutHeader(out, kBinaryCommand, sequence);
+  PutDouble(out + kBinaryHeaderSize, c.steering_angle);
+  PutDouble(out + kBinaryHeaderSize + 8, c.throttle);
+  return kBinaryCommandSize;
+}
+
+size_t WriteBinaryTelemetry(const Telemetry &t, uint32_t sequence, char *out,
+                            size_t capacity) {
+  if (capacity < kBinaryTelemetrySize) {
+    return 0;
+  }
+  PutHeader(out, kBinaryTelemetry, sequence);
+  PutDouble(out + kBinaryHeaderSize, t.cte);
+  PutDouble(out + kBinaryHeaderSize + 8, t.speed);
+  PutDouble(out + kBinaryHeaderSize + 16, t.angle);
+  return kBinaryTelemetrySize;
+}
+
+bool DecodeBinaryCommand(const char *data, size_t length, Command *c,
+                         uint32_t *sequence) {
+  if (!CheckHeader(data, length, kBinaryCommand, kBinaryCommandSize,
+                   sequence)) {
+    return false;
+  }
+  c->steering_angle = GetDouble(data + kBinaryHeaderSize);
+  c->throttle = GetDouble(data + kBinaryHeaderSize + 8);
+  return true;
+}
@@ -0,0 +1,62 @@
+#ifndef BINARY_PROTOCOL_H
+#define BINARY_PROTOCOL_H
+
+#include <cstddef>
+#include <cstdint>
+#include "telemetry.h"
+
+/*
+* Compact binary alternative to the socket.io text protocol, for simulator
+* stand-ins that opt in by connecting to kBinaryProtocolPath. Frames are sent
+* as websocket BINARY messages with a fixed little-endian layout:
+*
+*   offset  size  field
+*        0     4  magic 'PIDB' (0x42444950)
+*        4     2  version (kBinaryProtocolVersion)
+*        6     2  type (BinaryFrameType)
+*        8     4  sequence number, echoed in the command reply
+*       12     4  reserved, 0
+*
+* followed for telemetry by cte, speed and steering_angle, and for commands
+* by steering_angle and throttle, each an IEEE-754 double.
+*/
+
+// request path that selects the binary protocol in the websocket handshake
+const char kBinaryProtocolPath[] = "/pid-binary-v1";
+
+const uint32_t kBinaryProtocolMagic = 0x42444950;
+const uint16_t kBinaryProtocolVersion = 1;
+
+enum BinaryFrameType {
+  kBinaryTelemetry = 1,
+  kBinaryCommand = 2,
+};
+
+const size_t kBinaryHeaderSize = 16;
+const size_t kBinaryTelemetrySize = kBinaryHeaderSize + 3 * 8;
+const size_t kBinaryCommandSize = kBinaryHeaderSize + 2 * 8;
+
+/*
+* Decode a telemetry frame. Returns kDecodeMalformed if the frame has the
+* wrong size, magic, version or type, and kDecodeOutOfRange if a field is
+* infinite or NaN; *t is only written on kDecodeOk, and dt never is.
+*/
+DecodeStatus DecodeBinaryTelemetry(const char *data, size_t length,
+                                   Telemetry *t, uint32_t *sequence);
+
+/*
+* Encode a command frame into out, returning its size, or 0 if capacity is
+* smaller than kBinaryCommandSize.
+*/
+size_t WriteBinaryCommand(const Command &c, uint32_t sequence, char *out,
+                          size_t capacity);
+
+/*
+* The simulator side of the protocol.
+*/
+size_t WriteBinaryTelemetry(const Telemetry &t, uint32_t sequence, char *out,
+                            size_t capacity);
+bool DecodeBinaryCommand(const char *data, size_t length, Command *c,
+                         uint32_t *sequence);
+
+#endif /* BINARY_PROTOCOL_H */
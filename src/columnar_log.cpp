@@ -0,0 +1,314 @@
+#include "columnar_log.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cstring>
+
+// values are written and mapped in host order, which the format fixes as
+// little-endian
+static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__,
+              "columnar logs require a little-endian host");
+
+namespace {
+
+const char kColumnarMagic[8] = {'P', 'I', 'D', 'C', 'O', 'L', 'S', '\0'};
+
+uint64_t PadTo8(uint64_t size) { return (size + 7) & ~uint64_t(7); }
+
+// deflate never compresses better than about 1032:1
+const uint64_t kDeflateMaxRatio = 1032;
+
+template <typename T>
+void Put(std::vector<char> *out, const T &value) {
+  const char *p = reinterpret_cast<const char *>(&value);
+  out->insert(out->end(), p, p + sizeof(value));
+}
+
+template <typename T>
+T Get(const char *p) {
+  T value;
+  std::memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+}  // namespace
+
+ColumnarDeflater::ColumnarDeflater(int level) {
+  stream_.zalloc = Z_NULL;
+  stream_.zfree = Z_NULL;
+  stream_.opaque = Z_NULL;
+  initialized_ = deflateInit(&stream_, level) == Z_OK;
+}
+
+ColumnarDeflater::~ColumnarDeflater() {
+  if (initialized_) {
+    deflateEnd(&stream_);
+  }
+}
+
+bool ColumnarDeflater::Deflate(const char *data, size_t size,
+                               std::vector<char> *out) {
+  // the stream keeps its buffers between blocks; only its state is reset
+  if (!initialized_ || deflateReset(&stream_) != Z_OK) {
+    return false;
+  }
+  const size_t start = out->size();
+  out->resize(start + deflateBound(&stream_, size));
+  stream_.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data));
+  stream_.avail_in = size;
+  stream_.next_out = reinterpret_cast<Bytef *>(out->data() + start);
+  stream_.avail_out = out->size() - start;
+  if (deflate(&stream_, Z_FINISH) != Z_STREAM_END) {
+    out->resize(start);
+    return false;
+  }
+  out->resize(out->size() - stream_.avail_out);
+  return true;
+}
+
+ColumnarBlockBuilder::ColumnarBlockBuilder() : rows_(0) {}
+
+void ColumnarBlockBuilder::Add(const TelemetryRecord &record) {
+  timestamps_.push_back(record.timestamp);
+  columns_[kColumnCte].push_back(record.cte);
+  columns_[kColumnSpeed].push_back(record.speed);
+  columns_[kColumnAngle].push_back(record.angle);
+  columns_[kColumnSteering].push_back(record.steering_angle);
+  columns_[kColumnThrottle].push_back(record.throttle);
+  columns_[kColumnP].push_back(record.p_contrib);
+  columns_[kColumnI].push_back(record.i_contrib);
+  columns_[kColumnD].push_back(record.d_contrib);
+  ++rows_;
+}
+
+void ColumnarBlockBuilder::AppendPayload(std::vector<char> *out) const {
+  const char *p = reinterpret_cast<const char *>(timestamps_.data());
+  out->insert(out->end(), p, p + rows_ * 8);
+  for (int c = kColumnTimestamp + 1; c < kColumnCount; ++c) {
+    p = reinterpret_cast<const char *>(columns_[c].data());
+    out->insert(out->end(), p, p + rows_ * 8);
+  }
+}
+
+void ColumnarBlockBuilder::Flush(std::vector<char> *out,
+                                 ColumnarDeflater *deflater) {
+  bool deflated = false;
+  if (deflater) {
+    payload_.clear();
+    AppendPayload(&payload_);
+    const size_t header = out->size();
+    Put(out, kColumnarDeflatedBlockMagic);
+    Put(out, static_cast<uint32_t>(rows_));
+    Put(out, static_cast<uint64_t>(0));
+    deflated = deflater->Deflate(payload_.data(), payload_.size(), out);
+    if (deflated) {
+      const uint64_t stored = out->size() - header - kColumnarBlockHeaderSize;
+      std::memcpy(out->data() + header + 8, &stored, sizeof(stored));
+      out->resize(header + kColumnarBlockHeaderSize + PadTo8(stored));
+    } else {
+      // zlib failed; store the block uncompressed rather than lose it
+      out->resize(header);
+    }
+  }
+  if (!deflated) {
+    Put(out, kColumnarBlockMagic);
+    Put(out, static_cast<uint32_t>(rows_));
+    Put(out, static_cast<uint64_t>(rows_ * 8 * kColumnCount));
+    AppendPayload(out);
+  }
+  timestamps_.clear();
+  for (int c = kColumnTimestamp + 1; c < kColumnCount; ++c) {
+    columns_[c].clear();
+  }
+  rows_ = 0;
+}
+
+void AppendColumnarHeader(std::vector<char> *out) {
+  out->insert(out->end(), kColumnarMagic,
+              kColumnarMagic + sizeof(kColumnarMagic));
+  Put(out, kColumnarVersion);
+  Put(out, static_cast<uint32_t>(kColumnCount));
+  Put(out, static_cast<uint64_t>(0));
+}
+
+void AppendColumnarIndex(const std::vector<uint64_t> &block_offsets,
+                         uint64_t index_offset, std::vector<char> *out) {
+  for (size_t k = 0; k < block_offsets.size(); ++k) {
+    Put(out, block_offsets[k]);
+  }
+  Put(out, kColumnarFooterMagic);
+  Put(out, static_cast<uint32_t>(block_offsets.size()));
+  Put(out, index_offset);
+}
+
+ColumnarLogReader::ColumnarLogReader()
+    : data_(NULL), size_(0), rows_(0), inflated_block_(SIZE_MAX) {}
+
+ColumnarLogReader::~ColumnarLogReader() { Close(); }
+
+bool ColumnarLogReader::Open(const std::string &path) {
+  Close();
+  const int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 ||
+      static_cast<size_t>(st.st_size) < kColumnarHeaderSize) {
+    close(fd);
+    return false;
+  }
+  void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED) {
+    return false;
+  }
+  data_ = static_cast<const char *>(map);
+  size_ = st.st_size;
+  if (std::memcmp(data_, kColumnarMagic, sizeof(kColumnarMagic)) != 0 ||
+      Get<uint32_t>(data_ + 8) > kColumnarVersion ||
+      Get<uint32_t>(data_ + 12) != kColumnCount) {
+    Close();
+    return false;
+  }
+  // blocks are read sequentially, column by column
+  madvise(map, size_, MADV_SEQUENTIAL);
+  if (!ReadIndex()) {
+    WalkBlocks();
+  }
+  for (size_t k = 0; k < blocks_.size(); ++k) {
+    rows_ += rows(k);
+  }
+  return true;
+}
+
+void ColumnarLogReader::Close() {
+  if (data_) {
+    munmap(const_cast<char *>(data_), size_);
+  }
+  data_ = NULL;
+  size_ = 0;
+  blocks_.clear();
+  corrupt_.clear();
+  rows_ = 0;
+  inflated_block_ = SIZE_MAX;
+}
+
+ColumnarLogReader::BlockCheck ColumnarLogReader::CheckBlock(
+    uint64_t offset) const {
+  if (offset % 8 != 0 || offset > size_ ||
+      size_ - offset < kColumnarBlockHeaderSize) {
+    return kBlockMissing;
+  }
+  const uint32_t magic = Get<uint32_t>(data_ + offset);
+  const uint64_t rows = Get<uint32_t>(data_ + offset + 4);
+  const uint64_t stored = Get<uint64_t>(data_ + offset + 8);
+  const uint64_t available = size_ - offset - kColumnarBlockHeaderSize;
+  if ((magic != kColumnarBlockMagic &&
+       magic != kColumnarDeflatedBlockMagic) ||
+      PadTo8(stored) > available) {
+    return kBlockMissing;
+  }
+  // the stored size still locates the next block, but the row count has to
+  // be one the recorder could have written before anything is sized by it:
+  // never 0, at most kColumnarMaxBlockRows, and for a compressed payload no
+  // more than deflate can expand stored bytes to
+  const uint64_t size = rows * 8 * kColumnCount;
+  if (rows == 0 || rows > kColumnarMaxBlockRows) {
+    return kBlockCorrupt;
+  }
+  if (magic == kColumnarDeflatedBlockMagic) {
+    return size <= stored * kDeflateMaxRatio ? kBlockOk : kBlockCorrupt;
+  }
+  return stored == size ? kBlockOk : kBlockCorrupt;
+}
+
+bool ColumnarLogReader::ReadIndex() {
+  if (size_ < kColumnarHeaderSize + kColumnarFooterSize) {
+    return false;
+  }
+  const char *footer = data_ + size_ - kColumnarFooterSize;
+  if (Get<uint32_t>(footer) != kColumnarFooterMagic) {
+    return false;
+  }
+  const uint64_t count = Get<uint32_t>(footer + 4);
+  const uint64_t index = Get<uint64_t>(footer + 8);
+  if (index > size_ - kColumnarFooterSize ||
+      (size_ - kColumnarFooterSize - index) != count * 8) {
+    return false;
+  }
+  for (uint64_t k = 0; k < count; ++k) {
+    const uint64_t offset = Get<uint64_t>(data_ + index + k * 8);
+    const BlockCheck check = CheckBlock(offset);
+    if (check == kBlockMissing) {
+      blocks_.clear();
+      corrupt_.clear();
+      return false;
+    }
+    blocks_.push_back(offset);
+    corrupt_.push_back(check == kBlockCorrupt);
+  }
+  return true;
+}
+
+void ColumnarLogReader::WalkBlocks() {
+  uint64_t offset = kColumnarHeaderSize;
+  BlockCheck check;
+  while ((check = CheckBlock(offset)) != kBlockMissing) {
+    blocks_.push_back(offset);
+    corrupt_.push_back(check == kBlockCorrupt);
+    offset += kColumnarBlockHeaderSize +
+              PadTo8(Get<uint64_t>(data_ + offset + 8));
+  }
+}
+
+size_t ColumnarLogReader::rows(size_t block) const {
+  return corrupt_[block] ? 0 : Get<uint32_t>(data_ + blocks_[block] + 4);
+}
+
+const char *ColumnarLogReader::Payload(size_t block) const {
+  if (corrupt_[block]) {
+    return NULL;
+  }
+  const char *header = data_ + blocks_[block];
+  if (Get<uint32_t>(header) != kColumnarDeflatedBlockMagic) {
+    return header + kColumnarBlockHeaderSize;
+  }
+  if (inflated_block_ != block) {
+    uLongf size = rows(block) * 8 * kColumnCount;
+    inflated_.resize(size);
+    if (uncompress(reinterpret_cast<Bytef *>(inflated_.data()), &size,
+                   reinterpret_cast<const Bytef *>(header) +
+                       kColumnarBlockHeaderSize,
+                   Get<uint64_t>(header + 8)) != Z_OK ||
+        size != inflated_.size()) {
+      inflated_.clear();
+    }
+    inflated_block_ = block;
+  }
+  return inflated_.empty() ? NULL : inflated_.data();
+}
+
+bool ColumnarLogReader::readable(size_t block) const {
+  return Payload(block) != NULL;
+}
+
+Span<int64_t> ColumnarLogReader::timestamps(size_t block) const {
+  const char *payload = Payload(block);
+  Span<int64_t> span = {reinterpret_cast<const int64_t *>(payload),
+                        payload ? rows(block) : 0};
+  return span;
+}
+
+Span<double> ColumnarLogReader::column(size_t block, ColumnarColumn c) const {
+  const char *payload = Payload(block);
+  if (!payload) {
+    Span<double> empty = {NULL, 0};
+    return empty;
+  }
+  const size_t n = rows(block);
+  Span<double> span = {reinterpret_cast<const double *>(payload + c * n * 8),
+                       n};
+  return span;
+}
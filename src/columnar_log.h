@@ -0,0 +1,216 @@
+#ifndef COLUMNAR_LOG_H
+#define COLUMNAR_LOG_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <zlib.h>
+#include "telemetry.h"
+
+/*
+* Binary columnar telemetry log. All fields are little-endian and every
+* block starts 8-byte aligned, so the columns of an uncompressed block can
+* be read in place from a memory-mapped file:
+*
+*   file header  (kColumnarHeaderSize bytes)
+*     0  8  magic "PIDCOLS\0"
+*     8  4  version (kColumnarVersion)
+*    12  4  column count (kColumnCount)
+*    16  8  reserved, 0
+*   block, repeated
+*     0  4  magic 'PBLK' (kColumnarBlockMagic) or, if the payload is
+*           zlib-compressed, 'PBLZ' (kColumnarDeflatedBlockMagic)
+*     4  4  row count n
+*     8  8  stored payload size; n * 8 * kColumnCount uncompressed
+*    16     payload: n values of each column in ColumnarColumn order,
+*           zero-padded to a multiple of 8 bytes if compressed
+*   index, written when the file is closed
+*     8 bytes per block: file offset of the block
+*   footer  (kColumnarFooterSize bytes)
+*     0  4  magic 'PIDX' (kColumnarFooterMagic)
+*     4  4  block count
+*     8  8  file offset of the index
+*
+* The timestamp column holds int64 nanoseconds since the Unix epoch; every
+* other column holds doubles. Blocks are compressed independently, so the
+* index can seek into compressed logs too. A file without a valid footer
+* (e.g. the process died) is still readable by walking the blocks from the
+* header. Version 2 added compressed blocks.
+*/
+
+enum ColumnarColumn {
+  kColumnTimestamp,
+  kColumnCte,
+  kColumnSpeed,
+  kColumnAngle,
+  kColumnSteering,
+  kColumnThrottle,
+  kColumnP,
+  kColumnI,
+  kColumnD,
+  kColumnCount,
+};
+
+const uint32_t kColumnarVersion = 2;
+const uint32_t kColumnarBlockMagic = 0x4b4c4250;
+const uint32_t kColumnarDeflatedBlockMagic = 0x5a4c4250;
+const uint32_t kColumnarFooterMagic = 0x58444950;
+const size_t kColumnarHeaderSize = 24;
+const size_t kColumnarBlockHeaderSize = 16;
+const size_t kColumnarFooterSize = 16;
+// most rows the recorder writes in one block
+const size_t kColumnarMaxBlockRows = 4096;
+
+/*
+* Contiguous run of values in a mapped log.
+*/
+template <typename T>
+struct Span {
+  const T *data;
+  size_t size;
+
+  const T *begin() const { return data; }
+  const T *end() const { return data + size; }
+  const T &operator[](size_t k) const { return data[k]; }
+};
+
+/*
+* Reusable zlib stream for compressing block payloads one at a time.
+*/
+class ColumnarDeflater {
+ public:
+  explicit ColumnarDeflater(int level = Z_BEST_SPEED);
+  ~ColumnarDeflater();
+
+  /*
+  * Append data compressed as a complete zlib stream to out. Returns false,
+  * leaving out as it was, if zlib fails or couldn't be initialized.
+  */
+  bool Deflate(const char *data, size_t size, std::vector<char> *out);
+
+ private:
+  ColumnarDeflater(const ColumnarDeflater &);
+  ColumnarDeflater &operator=(const ColumnarDeflater &);
+
+  z_stream stream_;
+  // false if deflateInit failed, in which case stream_ is never used
+  bool initialized_;
+};
+
+/*
+* Collects rows column by column and serializes them as one block.
+*/
+class ColumnarBlockBuilder {
+ public:
+  ColumnarBlockBuilder();
+
+  void Add(const TelemetryRecord &record);
+
+  size_t rows() const { return rows_; }
+
+  /*
+  * Append the block to out, compressed with deflater unless it's NULL or
+  * fails, and start a new, empty one.
+  */
+  void Flush(std::vector<char> *out, ColumnarDeflater *deflater = NULL);
+
+ private:
+  void AppendPayload(std::vector<char> *out) const;
+
+  std::vector<int64_t> timestamps_;
+  std::vector<double> columns_[kColumnCount];
+  size_t rows_;
+  // uncompressed payload, for deflating
+  std::vector<char> payload_;
+};
+
+/*
+* Append the file header to out.
+*/
+void AppendColumnarHeader(std::vector<char> *out);
+
+/*
+* Append the index and footer for blocks at the given file offsets, the
+* index itself starting at file offset index_offset.
+*/
+void AppendColumnarIndex(const std::vector<uint64_t> &block_offsets,
+                         uint64_t index_offset, std::vector<char> *out);
+
+/*
+* Read-only view of a columnar log, memory-mapped in full. Columns of
+* uncompressed blocks are returned as spans into the mapping, valid while
+* the reader is open. A compressed block is inflated when one of its
+* columns is first asked for, and its spans stay valid until a column of
+* another compressed block is. A block whose header is implausible (a row
+* count of 0, over kColumnarMaxBlockRows or not matching its payload) or
+* whose compressed payload fails to inflate reads as empty spans.
+*/
+class ColumnarLogReader {
+ public:
+  ColumnarLogReader();
+  ~ColumnarLogReader();
+
+  /*
+  * Map path and locate its blocks, from the index if the file was closed
+  * cleanly and by walking the blocks otherwise. Returns false if the file
+  * can't be mapped or isn't a columnar log.
+  */
+  bool Open(const std::string &path);
+  void Close();
+
+  size_t blocks() const { return blocks_.size(); }
+
+  /*
+  * Rows in block, 0 if its header is corrupt.
+  */
+  size_t rows(size_t block) const;
+
+  /*
+  * Total rows over all blocks.
+  */
+  size_t rows() const { return rows_; }
+
+  /*
+  * False if block's header is corrupt or it fails to inflate.
+  */
+  bool readable(size_t block) const;
+
+  Span<int64_t> timestamps(size_t block) const;
+
+  /*
+  * Any column but kColumnTimestamp.
+  */
+  Span<double> column(size_t block, ColumnarColumn c) const;
+
+ private:
+  ColumnarLogReader(const ColumnarLogReader &);
+  ColumnarLogReader &operator=(const ColumnarLogReader &);
+
+  enum BlockCheck {
+    // no block can be located at the offset
+    kBlockMissing,
+    // located, but its row count can't be trusted
+    kBlockCorrupt,
+    kBlockOk,
+  };
+
+  bool ReadIndex();
+  void WalkBlocks();
+  BlockCheck CheckBlock(uint64_t offset) const;
+  // the block's columns, or NULL if it fails to inflate
+  const char *Payload(size_t block) const;
+
+  const char *data_;
+  size_t size_;
+  // file offsets of the blocks
+  std::vector<uint64_t> blocks_;
+  // whether each block's header is corrupt
+  std::vector<bool> corrupt_;
+  size_t rows_;
+  // the most recently inflated block, or SIZE_MAX if none
+  mutable size_t inflated_block_;
+  mutable std::vector<char> inflated_;
+};
+
+#endif /* COLUMNAR_LOG_H */
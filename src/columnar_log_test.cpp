@@ -0,0 +1,149 @@
+// Writes columnar logs, corrupts them, and checks that ColumnarLogReader
+// skips exactly the damaged blocks instead of failing or allocating what a
+// corrupt header asks for.
+//
+// usage: pid_columnar_log_test [corrupt log to leave behind]
+//
+// Covers both block formats: a row count far too large (what used to end in
+// std::bad_alloc), one just over the block limit, one of zero, one a
+// compressed payload can't expand to, and a compressed payload that fails
+// to inflate. With a path, a log whose first block header is corrupt is
+// also written there for pid_log_dump and pid_precision_report to read.
+// Exits non-zero if any check fails.
+
+#include <unistd.h>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "columnar_log.h"
+
+namespace {
+
+const size_t kBlocks = 3;
+const size_t kRows = 10;
+
+bool Check(bool ok, const std::string &name) {
+  std::printf("%-60s %s\n", name.c_str(), ok ? "ok" : "FAILED");
+  return ok;
+}
+
+// A finished log of kBlocks blocks of kRows rows each; row k of block b has
+// timestamp b * kRows + k and cte equal to its timestamp.
+std::vector<char> WriteLog(bool deflate, std::vector<uint64_t> *offsets) {
+  std::vector<char> out;
+  AppendColumnarHeader(&out);
+  ColumnarBlockBuilder block;
+  ColumnarDeflater deflater;
+  for (size_t b = 0; b < kBlocks; ++b) {
+    for (size_t k = 0; k < kRows; ++k) {
+      TelemetryRecord record = TelemetryRecord();
+      record.timestamp = b * kRows + k;
+      record.cte = static_cast<double>(record.timestamp);
+      block.Add(record);
+    }
+    offsets->push_back(out.size());
+    block.Flush(&out, deflate ? &deflater : NULL);
+  }
+  AppendColumnarIndex(*offsets, out.size(), &out);
+  return out;
+}
+
+bool Save(const std::vector<char> &log, const std::string &path) {
+  FILE *f = std::fopen(path.c_str(), "wb");
+  if (!f) {
+    return false;
+  }
+  const bool ok = std::fwrite(log.data(), 1, log.size(), f) == log.size();
+  return std::fclose(f) == 0 && ok;
+}
+
+// Whether block b reads back as written.
+bool Intact(const ColumnarLogReader &reader, size_t b) {
+  if (!reader.readable(b) || reader.rows(b) != kRows) {
+    return false;
+  }
+  const Span<int64_t> timestamps = reader.timestamps(b);
+  const Span<double> cte = reader.column(b, kColumnCte);
+  for (size_t k = 0; k < kRows; ++k) {
+    if (timestamps[k] != static_cast<int64_t>(b * kRows + k) ||
+        cte[k] != static_cast<double>(timestamps[k])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Opens log and checks that exactly block bad is skipped.
+bool OnlyBlockSkipped(const std::vector<char> &log, size_t bad,
+                      const std::string &path) {
+  if (!Save(log, path)) {
+    return false;
+  }
+  ColumnarLogReader reader;
+  bool ok = reader.Open(path) && reader.blocks() == kBlocks;
+  for (size_t b = 0; ok && b < kBlocks; ++b) {
+    ok = b == bad ? !reader.readable(b) && reader.timestamps(b).size == 0 &&
+                        reader.column(b, kColumnCte).size == 0
+                  : Intact(reader, b);
+  }
+  return ok;
+}
+
+void SetRows(std::vector<char> *log, uint64_t offset, uint32_t rows) {
+  std::memcpy(log->data() + offset + 4, &rows, sizeof(rows));
+}
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+  const std::string scratch =
+      "pid_columnar_log_test." + std::to_string(getpid()) + ".log";
+  bool ok = true;
+  for (int deflate = 0; deflate < 2; ++deflate) {
+    const std::string format = deflate ? "compressed: " : "uncompressed: ";
+    std::vector<uint64_t> offsets;
+    const std::vector<char> log = WriteLog(deflate, &offsets);
+
+    // no block is kBlocks, so none may be skipped
+    ok &= Check(OnlyBlockSkipped(log, kBlocks, scratch),
+                format + "intact log reads back");
+
+    std::vector<char> copy;
+    const uint32_t bad_rows[] = {0x7ffffff0, kColumnarMaxBlockRows + 1, 0,
+                                 kColumnarMaxBlockRows};
+    for (size_t k = 0; k < sizeof(bad_rows) / sizeof(bad_rows[0]); ++k) {
+      // the last is within the limit but more than the 10-row compressed
+      // payload can expand to, and more than the uncompressed one holds
+      copy = log;
+      SetRows(&copy, offsets[1], bad_rows[k]);
+      ok &= Check(OnlyBlockSkipped(copy, 1, scratch),
+                  format + "row count " + std::to_string(bad_rows[k]) +
+                      " skips the block");
+    }
+
+    // the same with the index gone, so the blocks are found by walking
+    copy = log;
+    copy.resize(copy.size() - kColumnarFooterSize - kBlocks * 8);
+    SetRows(&copy, offsets[1], 0x7ffffff0);
+    ok &= Check(OnlyBlockSkipped(copy, 1, scratch),
+                format + "walking past a corrupt header");
+  }
+
+  // a compressed payload that fails to inflate
+  std::vector<uint64_t> offsets;
+  std::vector<char> log = WriteLog(true, &offsets);
+  std::memset(log.data() + offsets[2] + kColumnarBlockHeaderSize + 4, 0x55, 8);
+  ok &= Check(OnlyBlockSkipped(log, 2, scratch),
+              "compressed: corrupt payload skips the block");
+  unlink(scratch.c_str());
+
+  if (argc > 1) {
+    offsets.clear();
+    log = WriteLog(true, &offsets);
+    SetRows(&log, offsets[0], 0x7ffffff0);
+    ok &= Check(Save(log, argv[1]), "wrote a log with a corrupt header");
+  }
+  return ok ? 0 : 1;
+}
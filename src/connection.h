@@ -0,0 +1,64 @@
+#ifndef CONNECTION_H
+#define CONNECTION_H
+
+#include <cstddef>
+#include <cstdint>
+#include "sample_clock.h"
+#include "telemetry.h"
+
+/*
+* Per-connection state, attached to the websocket as user data in
+* onConnection and freed in onDisconnection.
+*/
+struct Connection {
+  Connection()
+      : binary(false), sequence(0), has_pending(false), skipped_dt(0),
+        skipped_steps(0), skipped_cte(0), frames_dropped(0),
+        heap_allocations(0), allocating_messages(0), has_command(false),
+        decode_malformed(0), decode_missing_field(0),
+        decode_out_of_range(0) {}
+
+  // the peer negotiated the binary protocol at connect time
+  bool binary;
+
+  // sequence number of the last binary telemetry frame, echoed in replies
+  uint32_t sequence;
+
+  // interval between this peer's telemetry frames
+  SampleClock clock;
+
+  // coalescing mode: the freshest telemetry not yet controlled on, the
+  // interval (seconds and nominal steps) and integrated cte of the frames it
+  // superseded, and how many frames were dropped
+  bool has_pending;
+  Telemetry pending;
+  double skipped_dt;
+  double skipped_steps;
+  double skipped_cte;
+  uint64_t frames_dropped;
+
+  // global heap allocations made while processing messages, and the number
+  // of messages that made any. only counted with PID_COUNT_ALLOCATIONS
+  uint64_t heap_allocations;
+  uint64_t allocating_messages;
+
+  // the last command sent in reply to good telemetry, repeated when a frame
+  // is rejected
+  bool has_command;
+  Command last_command;
+
+  // telemetry frames rejected by DecodeTelemetry or DecodeBinaryTelemetry,
+  // by DecodeStatus. text frames on a binary connection count as malformed
+  uint64_t decode_malformed;
+  uint64_t decode_missing_field;
+  uint64_t decode_out_of_range;
+
+  // largest frame WriteSteerReply can produce, with room to spare
+  static const size_t kReplyCapacity = 128;
+
+  // replies are serialized into and sent from this buffer, so sending
+  // doesn't allocate
+  char reply[kReplyCapacity];
+};
+
+#endif /* CONNECTION_H */
@@ -0,0 +1,133 @@
+#ifndef CONTROL_PIPELINE_H
+#define CONTROL_PIPELINE_H
+
+#include <math.h>
+#include "PID.h"
+#include "gain_schedule.h"
+#include "seqlock.h"
+#include "telemetry.h"
+
+/*
+* Pipeline stages. Each stage is a plain class with a single inline entry
+* point; ControlPipeline calls them in order, so the composed Step() inlines
+* into one function.
+*/
+
+// Uses the telemetry as the vehicle state estimate.
+class PassthroughEstimator {
+ public:
+  Telemetry Estimate(const Telemetry &t) { return t; }
+};
+
+// Steering PID with speed-scheduled gains. If tuning is set, schedules
+// published there by another thread replace the current one between steps
+// without blocking and without resetting the error state. While the
+// schedule is empty the gains the PID was initialized with stay in effect.
+class ScheduledSteering {
+ public:
+  PID pid;
+  GainSchedule schedule;
+  const Seqlock<GainSchedule> *tuning;
+
+  ScheduledSteering() : tuning(NULL), tuning_version_(0) {}
+
+  double Steer(const Telemetry &t) {
+    if (tuning) {
+      tuning->TryLoad(&schedule, &tuning_version_);
+    }
+    if (schedule.size() > 0) {
+      double Kp, Ki, Kd;
+      schedule.Lookup(t.speed, &Kp, &Ki, &Kd);
+      pid.UpdateGains(Kp, Ki, Kd);
+    }
+    pid.UpdateError(t.cte, t.dt);
+    return pid.TotalError();
+  }
+
+ private:
+  uint64_t tuning_version_;
+};
+
+// Slows down on turns, targeting min_turn_speed at or above
+// approx_max_steering_angle degrees.
+class TurnSlowdownPlanner {
+ public:
+  double max_speed;
+  double min_turn_speed;
+  double approx_max_steering_angle;
+
+  TurnSlowdownPlanner()
+      : max_speed(45.0), min_turn_speed(35.0),
+        approx_max_steering_angle(12.0) {}
+
+  double TargetSpeed(const Telemetry &t) {
+    double desired_speed = max_speed - (max_speed - min_turn_speed) *
+                           fabs(t.angle / approx_max_steering_angle);
+    // dont go below min speed if angle is larger than approx max
+    if (desired_speed < min_turn_speed) {desired_speed = min_turn_speed;}
+    return desired_speed;
+  }
+};
+
+// Speed PID driving the throttle towards the target speed.
+class PIDThrottle {
+ public:
+  PID pid;
+
+  double Throttle(const Telemetry &t, double target_speed) {
+    pid.UpdateError(t.speed - target_speed, t.dt);
+    return pid.TotalError();
+  }
+};
+
+// Releases the gas instead of braking when the throttle is only slightly
+// negative, i.e. in (release_threshold, 0). The default of 0 never releases.
+class ReleaseGasShaper {
+ public:
+  double release_threshold;
+
+  ReleaseGasShaper() : release_threshold(0.0) {}
+
+  Command Shape(const Telemetry &, Command c) {
+    if (c.throttle < 0.0 && c.throttle > release_threshold) {
+      c.throttle = 0.0;
+    }
+    return c;
+  }
+};
+
+/*
+* Telemetry-to-command controller assembled from compile-time stages. Stages
+* are public so they can be configured in place.
+*/
+template <typename Estimator, typename SteeringController,
+          typename SpeedPlanner, typename ThrottleController,
+          typename OutputShaper>
+class ControlPipeline {
+ public:
+  Estimator estimator;
+  SteeringController steering;
+  SpeedPlanner planner;
+  ThrottleController throttle;
+  OutputShaper shaper;
+
+  /*
+  * Run every stage on one telemetry sample.
+  */
+  Command Step(const Telemetry &raw) {
+    const Telemetry t = estimator.Estimate(raw);
+    Command c;
+    c.steering_angle = steering.Steer(t);
+    c.throttle = throttle.Throttle(t, planner.TargetSpeed(t));
+    return shaper.Shape(t, c);
+  }
+};
+
+/*
+* The pipeline driving the simulator.
+*/
+typedef ControlPipeline<PassthroughEstimator, ScheduledSteering,
+                        TurnSlowdownPlanner, PIDThrottle, ReleaseGasShaper>
+    CarPipeline;
+
+#endif /* CONTROL_PIPELINE_H */
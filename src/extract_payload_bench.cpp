@@ -0,0 +1,86 @@
+// Times ExtractPayload against the hasData() it replaced, on the frames the
+// simulator sends, and checks both find the same payload.
+//
+// usage: pid_extract_payload_bench [iterations]
+//
+// hasData() is reproduced as it was: the frame copied into a std::string,
+// searched with find, find_first_of and find_last_of, and the payload
+// returned as a substring. The frames are telemetry without and with a
+// base64 camera image, and the manual-mode frame. Exits non-zero if the two
+// disagree on any frame.
+
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "bench.h"
+#include "socketio.h"
+
+namespace {
+
+std::string hasData(std::string s) {
+  auto found_null = s.find("null");
+  auto b1 = s.find_first_of("[");
+  auto b2 = s.find_last_of("]");
+  if (found_null != std::string::npos) {
+    return "";
+  }  else if (b1 != std::string::npos && b2 != std::string::npos) {
+    return s.substr(b1, b2 - b1 + 1);
+  }
+  return "";
+}
+
+bool Agrees(const std::string &frame) {
+  Slice payload;
+  const bool found = ExtractPayload(frame.data(), frame.size(), &payload);
+  const std::string expected = hasData(frame);
+  return found ? expected == std::string(payload.data, payload.size)
+               : expected.empty();
+}
+
+// Returns false if the two disagree on any of the frames.
+bool Compare(const char *name, const std::vector<std::string> &frames,
+             long iterations) {
+  bool agree = true;
+  for (size_t k = 0; k < frames.size(); ++k) {
+    agree &= Agrees(frames[k]);
+  }
+  const size_t n = frames.size();
+  const double extract_seconds = BestSeconds([&]() {
+    size_t bytes = 0;
+    for (long k = 0; k < iterations; ++k) {
+      const std::string &frame = frames[k % n];
+      Slice payload;
+      if (ExtractPayload(frame.data(), frame.size(), &payload)) {
+        bytes += payload.size;
+      }
+    }
+    Consume(bytes);
+  });
+  const double has_data_seconds = BestSeconds([&]() {
+    size_t bytes = 0;
+    for (long k = 0; k < iterations; ++k) {
+      const std::string &frame = frames[k % n];
+      bytes += hasData(std::string(frame.data()).substr(0, frame.size()))
+                   .size();
+    }
+    Consume(bytes);
+  });
+  std::printf("%-22s ExtractPayload %8.1f ns, hasData %8.1f ns%s\n", name,
+              extract_seconds * 1e9 / iterations,
+              has_data_seconds * 1e9 / iterations,
+              agree ? "" : "  MISMATCH");
+  return agree;
+}
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+  const long iterations = Iterations(argc, argv, 1000000);
+
+  const SimulatorFrames frames;
+  bool ok = true;
+  ok &= Compare("telemetry", frames.telemetry, iterations);
+  ok &= Compare("telemetry, 16 KB image", frames.image, iterations / 100 + 1);
+  ok &= Compare("manual", frames.manual, iterations);
+  return ok ? 0 : 1;
+}
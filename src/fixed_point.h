@@ -0,0 +1,101 @@
+#ifndef FIXED_POINT_H
+#define FIXED_POINT_H
+
+#include <cstdint>
+
+/*
+* Signed Q16.16 fixed-point number, usable as the Scalar of BasicPID and
+* BasicPIDBank. Sums, differences, negation and integer conversion wrap
+* modulo 2^32; they are computed in uint32_t so overflow is well defined.
+* Products and quotients go through a 64-bit intermediate and wrap the same
+* way. Products round toward negative infinity, and quotients round toward
+* zero; dividing by zero is undefined. A double is rounded to nearest, one
+* outside the representable range saturates, and NaN converts to zero.
+*/
+class Fixed16 {
+ public:
+  static const int kFractionBits = 16;
+
+  Fixed16() : raw_(0) {}
+  Fixed16(int value)
+      : raw_(Wrap(static_cast<uint32_t>(value) << kFractionBits)) {}
+  Fixed16(double value) : raw_(Round(value)) {}
+
+  /*
+  * Construct from a raw Q16.16 bit pattern.
+  */
+  static Fixed16 FromRaw(int32_t raw) {
+    Fixed16 f;
+    f.raw_ = raw;
+    return f;
+  }
+
+  int32_t raw() const { return raw_; }
+
+  double ToDouble() const {
+    return static_cast<double>(raw_) / (1 << kFractionBits);
+  }
+
+  explicit operator double() const { return ToDouble(); }
+
+  Fixed16 operator-() const {
+    return FromRaw(Wrap(0u - static_cast<uint32_t>(raw_)));
+  }
+
+  Fixed16 &operator+=(Fixed16 rhs) {
+    raw_ = Wrap(static_cast<uint32_t>(raw_) + static_cast<uint32_t>(rhs.raw_));
+    return *this;
+  }
+  Fixed16 &operator-=(Fixed16 rhs) {
+    raw_ = Wrap(static_cast<uint32_t>(raw_) - static_cast<uint32_t>(rhs.raw_));
+    return *this;
+  }
+  Fixed16 &operator*=(Fixed16 rhs) {
+    // the product of two int32_t always fits in int64_t; >> on a negative
+    // one is an arithmetic shift with GCC and Clang, i.e. it floors
+    const int64_t product = static_cast<int64_t>(raw_) * rhs.raw_;
+    raw_ = Wrap(static_cast<uint32_t>(product >> kFractionBits));
+    return *this;
+  }
+  Fixed16 &operator/=(Fixed16 rhs) {
+    // scaled by multiplying, since left-shifting a negative value is
+    // undefined
+    const int64_t quotient =
+        static_cast<int64_t>(raw_) * (int64_t(1) << kFractionBits) /
+        rhs.raw_;
+    raw_ = Wrap(static_cast<uint32_t>(quotient));
+    return *this;
+  }
+
+  friend Fixed16 operator+(Fixed16 a, Fixed16 b) { return a += b; }
+  friend Fixed16 operator-(Fixed16 a, Fixed16 b) { return a -= b; }
+  friend Fixed16 operator*(Fixed16 a, Fixed16 b) { return a *= b; }
+  friend Fixed16 operator/(Fixed16 a, Fixed16 b) { return a /= b; }
+
+  friend bool operator==(Fixed16 a, Fixed16 b) { return a.raw_ == b.raw_; }
+  friend bool operator!=(Fixed16 a, Fixed16 b) { return a.raw_ != b.raw_; }
+  friend bool operator<(Fixed16 a, Fixed16 b) { return a.raw_ < b.raw_; }
+  friend bool operator>(Fixed16 a, Fixed16 b) { return a.raw_ > b.raw_; }
+  friend bool operator<=(Fixed16 a, Fixed16 b) { return a.raw_ <= b.raw_; }
+  friend bool operator>=(Fixed16 a, Fixed16 b) { return a.raw_ >= b.raw_; }
+
+ private:
+  // Two's-complement reinterpretation of bits. The conversion is
+  // implementation-defined before C++20, and modular with GCC and Clang.
+  static int32_t Wrap(uint32_t bits) { return static_cast<int32_t>(bits); }
+
+  static int32_t Round(double value) {
+    const double scaled = value * (1 << kFractionBits);
+    if (!(scaled < 2147483647.0)) {
+      return scaled != scaled ? 0 : INT32_MAX;
+    }
+    if (!(scaled > -2147483648.0)) {
+      return INT32_MIN;
+    }
+    return static_cast<int32_t>(scaled + (scaled < 0 ? -0.5 : 0.5));
+  }
+
+  int32_t raw_;
+};
+
+#endif /* FIXED_POINT_H */
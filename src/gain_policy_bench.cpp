@@ -0,0 +1,128 @@
+// Times the header-only BasicPID, with run-time and compile-time gains,
+// against the out-of-line PID it replaced, and checks all three agree.
+//
+// usage: pid_gain_policy_bench [steps]
+//
+// LegacyPID reproduces the old class: a virtual destructor and UpdateError
+// and TotalError compiled out of line, here kept out of line with noinline
+// since they used to live in their own translation unit. Each variant runs
+// the steering controller over the same cte trace. Exits non-zero if any
+// output differs.
+
+#include <cstdio>
+#include <vector>
+#include "PID.h"
+#include "bench.h"
+
+namespace {
+
+// the compile-time policy from PID.h's doc comment, so CI builds that path
+struct SteeringGains {
+  static constexpr double kp() { return 0.237662; }
+  static constexpr double ki() { return 0.000671427; }
+  static constexpr double kd() { return 2.75795; }
+};
+
+class LegacyPID {
+ public:
+  double p_error;
+  double i_error;
+  double d_error;
+
+  double Kp;
+  double Ki;
+  double Kd;
+
+  LegacyPID() {}
+  virtual ~LegacyPID() {}
+
+  void Init(double Kp, double Ki, double Kd) {
+    this->Kp = Kp;
+    this->Ki = Ki;
+    this->Kd = Kd;
+
+    p_error = 0;
+    i_error = 0;
+    d_error = 0;
+  }
+
+  __attribute__((noinline)) void UpdateError(double cte) {
+    i_error += cte;
+    d_error = cte - p_error;
+    p_error = cte;
+  }
+
+  __attribute__((noinline)) double TotalError() {
+    return (-Kp * p_error - Kd * d_error - Ki * i_error);
+  }
+};
+
+template <typename Controller>
+double Run(Controller *pid, const std::vector<double> &trace, long steps,
+           std::vector<double> *out) {
+  const size_t n = trace.size();
+  double sum = 0;
+  size_t i = 0;
+  for (long k = 0; k < steps; ++k) {
+    pid->UpdateError(trace[i]);
+    const double total = pid->TotalError();
+    if (out) {
+      out->push_back(total);
+    }
+    sum += total;
+    i = i + 1 == n ? 0 : i + 1;
+  }
+  return sum;
+}
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+  const long steps = Iterations(argc, argv, 50000000);
+
+  std::vector<double> trace(4096);
+  for (size_t k = 0; k < trace.size(); ++k) {
+    trace[k] = 0.001 * static_cast<double>((k * 7919) % 2001) - 1.0;
+  }
+
+  LegacyPID legacy;
+  PID runtime;
+  BasicPID<double, SteeringGains> fixed;
+  legacy.Init(SteeringGains::kp(), SteeringGains::ki(), SteeringGains::kd());
+  runtime.Init(SteeringGains::kp(), SteeringGains::ki(), SteeringGains::kd());
+  fixed.Init();
+
+  const long checked = steps < 100000 ? steps : 100000;
+  std::vector<double> legacy_out, runtime_out, fixed_out;
+  Run(&legacy, trace, checked, &legacy_out);
+  Run(&runtime, trace, checked, &runtime_out);
+  Run(&fixed, trace, checked, &fixed_out);
+  long mismatches = 0;
+  for (long k = 0; k < checked; ++k) {
+    if (runtime_out[k] != legacy_out[k] || fixed_out[k] != legacy_out[k]) {
+      ++mismatches;
+    }
+  }
+  std::printf("%ld of %ld outputs differ\n", mismatches, checked);
+
+  const double legacy_seconds = BestSeconds([&]() {
+    legacy.Init(SteeringGains::kp(), SteeringGains::ki(), SteeringGains::kd());
+    Consume(Run(&legacy, trace, steps, NULL));
+  });
+  const double runtime_seconds = BestSeconds([&]() {
+    runtime.Init();
+    Consume(Run(&runtime, trace, steps, NULL));
+  });
+  const double fixed_seconds = BestSeconds([&]() {
+    fixed.Init();
+    Consume(Run(&fixed, trace, steps, NULL));
+  });
+
+  std::printf("out-of-line PID      %6.2f ns/step\n",
+              legacy_seconds * 1e9 / steps);
+  std::printf("BasicPID, run-time   %6.2f ns/step\n",
+              runtime_seconds * 1e9 / steps);
+  std::printf("BasicPID, constexpr  %6.2f ns/step\n",
+              fixed_seconds * 1e9 / steps);
+  return mismatches == 0 ? 0 : 1;
+}
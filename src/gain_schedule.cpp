@@ -0,0 +1,67 @@
+#include "gain_schedule.h"
+#include <fstream>
+#include <sstream>
+
+GainSchedule::GainSchedule() : count_(0) {
+  for (int k = 0; k < kMaxBreakpoints; ++k) {
+    speed_[k] = 0;
+    kp_[k] = 0;
+    ki_[k] = 0;
+    kd_[k] = 0;
+    inv_span_[k] = 0;
+  }
+}
+
+bool GainSchedule::Add(double speed, double Kp, double Ki, double Kd) {
+  if (count_ == kMaxBreakpoints ||
+      (count_ > 0 && !(speed > speed_[count_ - 1]))) {
+    return false;
+  }
+  speed_[count_] = speed;
+  kp_[count_] = Kp;
+  ki_[count_] = Ki;
+  kd_[count_] = Kd;
+  ++count_;
+  Pad();
+  return true;
+}
+
+bool GainSchedule::Load(const std::string &path) {
+  std::ifstream in(path.c_str());
+  if (!in) {
+    return false;
+  }
+  GainSchedule loaded;
+  std::string line;
+  while (std::getline(in, line)) {
+    std::istringstream fields(line);
+    std::string first;
+    if (!(fields >> first) || first[0] == '#') {
+      continue;
+    }
+    std::istringstream row(line);
+    double speed, Kp, Ki, Kd;
+    if (!(row >> speed >> Kp >> Ki >> Kd) || !loaded.Add(speed, Kp, Ki, Kd)) {
+      return false;
+    }
+  }
+  if (loaded.size() == 0) {
+    return false;
+  }
+  *this = loaded;
+  return true;
+}
+
+void GainSchedule::Pad() {
+  for (int k = count_; k < kMaxBreakpoints; ++k) {
+    speed_[k] = speed_[count_ - 1];
+    kp_[k] = kp_[count_ - 1];
+    ki_[k] = ki_[count_ - 1];
+    kd_[k] = kd_[count_ - 1];
+  }
+  for (int k = 0; k < kMaxBreakpoints - 1; ++k) {
+    const double span = speed_[k + 1] - speed_[k];
+    inv_span_[k] = span > 0 ? 1.0 / span : 0.0;
+  }
+  inv_span_[kMaxBreakpoints - 1] = 0;
+}
@@ -0,0 +1,76 @@
+#ifndef GAIN_SCHEDULE_H
+#define GAIN_SCHEDULE_H
+
+#include <string>
+
+/*
+* Speed-indexed PID gain table. Gains are linearly interpolated between
+* breakpoints and held constant outside the table. Lookups always walk all
+* kMaxBreakpoints entries without branching, so their cost doesn't depend on
+* the speed; the whole table fits in a handful of cache lines.
+*/
+class GainSchedule {
+ public:
+  static const int kMaxBreakpoints = 8;
+
+  /*
+  * Constructor
+  */
+  GainSchedule();
+
+  /*
+  * Append a breakpoint. Speeds must be strictly increasing. Returns false if
+  * the table is full or the speed is out of order.
+  */
+  bool Add(double speed, double Kp, double Ki, double Kd);
+
+  /*
+  * Replace the table with the breakpoints in a text file, one
+  * "speed Kp Ki Kd" row per line. Blank lines and lines starting with '#'
+  * are ignored. Returns false, leaving the table unchanged, if the file
+  * can't be read or holds no valid table.
+  */
+  bool Load(const std::string &path);
+
+  /*
+  * Number of breakpoints.
+  */
+  int size() const { return count_; }
+
+  /*
+  * Interpolated gains at the given speed. The table must not be empty.
+  */
+  void Lookup(double speed, double *Kp, double *Ki, double *Kd) const {
+    const double s = Clamp(speed);
+    // index of the segment containing s; entries past the last breakpoint
+    // repeat it, so they never count
+    int lo = 0;
+    for (int k = 1; k < kMaxBreakpoints - 1; ++k) {
+      lo += s > speed_[k];
+    }
+    const double t = (s - speed_[lo]) * inv_span_[lo];
+    *Kp = kp_[lo] + t * (kp_[lo + 1] - kp_[lo]);
+    *Ki = ki_[lo] + t * (ki_[lo + 1] - ki_[lo]);
+    *Kd = kd_[lo] + t * (kd_[lo + 1] - kd_[lo]);
+  }
+
+ private:
+  double Clamp(double speed) const {
+    const double above = speed > speed_[0] ? speed : speed_[0];
+    return above < speed_[kMaxBreakpoints - 1] ? above
+                                               : speed_[kMaxBreakpoints - 1];
+  }
+
+  // Copies the last breakpoint into the unused slots and recomputes the
+  // per-segment 1 / (speed[k + 1] - speed[k]), which is 0 for padding.
+  void Pad();
+
+  double speed_[kMaxBreakpoints];
+  double kp_[kMaxBreakpoints];
+  double ki_[kMaxBreakpoints];
+  double kd_[kMaxBreakpoints];
+  double inv_span_[kMaxBreakpoints];
+  int count_;
+};
+
+#endif /* GAIN_SCHEDULE_H */
@@ -0,0 +1,69 @@
+#ifndef LOG_H
+#define LOG_H
+
+#include <cstdint>
+#include "async_logger.h"
+
+/*
+* Leveled logging through AsyncLogger. Statements below the build's
+* PID_LOG_LEVEL (set with -DPID_LOG_LEVEL=DEBUG|INFO|WARNING|ERROR|NONE)
+* sit behind a constant-false condition: they still have to compile, but
+* the optimizer drops them and their arguments entirely.
+*
+*   PID_LOG(DEBUG, logger, kControlRecord, cte, steering);
+*   PID_LOG_SAMPLED(DEBUG, sampler, logger, kSteerRecord, angle, throttle);
+*
+* The sampled form only logs when sampler.Sample() says so, which costs a
+* counter increment and compare; a disabled level skips even that.
+*/
+#define PID_LOG_LEVEL_DEBUG 0
+#define PID_LOG_LEVEL_INFO 1
+#define PID_LOG_LEVEL_WARNING 2
+#define PID_LOG_LEVEL_ERROR 3
+#define PID_LOG_LEVEL_NONE 4
+
+#ifndef PID_LOG_LEVEL
+#define PID_LOG_LEVEL PID_LOG_LEVEL_DEBUG
+#endif
+
+#define PID_LOG_ENABLED(level) (PID_LOG_LEVEL_##level >= PID_LOG_LEVEL)
+
+#define PID_LOG(level, logger, type, a, b) \
+  do {                                     \
+    if (PID_LOG_ENABLED(level)) {          \
+      (logger).Log(type, a, b);            \
+    }                                      \
+  } while (0)
+
+#define PID_LOG_SAMPLED(level, sampler, logger, type, a, b) \
+  do {                                                      \
+    if (PID_LOG_ENABLED(level) && (sampler).Sample()) {     \
+      (logger).Log(type, a, b);                             \
+    }                                                       \
+  } while (0)
+
+/*
+* Passes one in every n calls to Sample(), starting with the first. n can be
+* changed at any time from the logging thread; 1 passes every call.
+*/
+class LogSampler {
+ public:
+  explicit LogSampler(uint32_t n = 1) : n_(n), count_(0) {}
+
+  void set_n(uint32_t n) { n_ = n; }
+
+  bool Sample() {
+    if (count_ != 0) {
+      count_ = count_ + 1 < n_ ? count_ + 1 : 0;
+      return false;
+    }
+    count_ = n_ > 1 ? 1 : 0;
+    return true;
+  }
+
+ private:
+  uint32_t n_;
+  uint32_t count_;
+};
+
+#endif /* LOG_H */
@@ -0,0 +1,126 @@
+// Prints a columnar telemetry log as text, or summarizes it.
+//
+// usage: pid_log_dump [--summary] <log>
+//
+// By default every row is printed as space-separated columns with a header
+// line. --summary prints the row and block counts, the time span, and the
+// mean and maximum absolute value of each column instead. Corrupt blocks
+// are reported on stderr and skipped, and the exit status is 1.
+
+#include <math.h>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include "columnar_log.h"
+
+namespace {
+
+const char *const kColumnNames[kColumnCount] = {
+    "timestamp", "cte", "speed", "angle", "steering_angle",
+    "throttle", "p_contrib", "i_contrib", "d_contrib",
+};
+
+// Reports block b on stderr and returns false if it can't be read.
+bool CheckBlock(const ColumnarLogReader &log, size_t b) {
+  if (log.readable(b)) {
+    return true;
+  }
+  // rows(b) is 0 when the header itself is corrupt
+  if (log.rows(b)) {
+    std::fprintf(stderr, "block %zu: corrupt block, %zu rows skipped\n", b,
+                 log.rows(b));
+  } else {
+    std::fprintf(stderr, "block %zu: corrupt block header, skipped\n", b);
+  }
+  return false;
+}
+
+// Returns the number of blocks that couldn't be read.
+size_t Dump(const ColumnarLogReader &log) {
+  std::printf("%s", kColumnNames[0]);
+  for (int c = 1; c < kColumnCount; ++c) {
+    std::printf(" %s", kColumnNames[c]);
+  }
+  std::printf("\n");
+  size_t bad_blocks = 0;
+  for (size_t b = 0; b < log.blocks(); ++b) {
+    if (!CheckBlock(log, b)) {
+      ++bad_blocks;
+      continue;
+    }
+    const Span<int64_t> timestamps = log.timestamps(b);
+    Span<double> columns[kColumnCount];
+    for (int c = 1; c < kColumnCount; ++c) {
+      columns[c] = log.column(b, static_cast<ColumnarColumn>(c));
+    }
+    for (size_t k = 0; k < timestamps.size; ++k) {
+      std::printf("%" PRId64, timestamps[k]);
+      for (int c = 1; c < kColumnCount; ++c) {
+        std::printf(" %.17g", columns[c][k]);
+      }
+      std::printf("\n");
+    }
+  }
+  return bad_blocks;
+}
+
+// Returns the number of blocks that couldn't be read.
+size_t Summarize(const ColumnarLogReader &log) {
+  double sum[kColumnCount] = {};
+  double max_abs[kColumnCount] = {};
+  int64_t first = 0, last = 0;
+  size_t rows = 0, bad_blocks = 0;
+  for (size_t b = 0; b < log.blocks(); ++b) {
+    if (!CheckBlock(log, b)) {
+      ++bad_blocks;
+      continue;
+    }
+    const Span<int64_t> timestamps = log.timestamps(b);
+    if (timestamps.size == 0) {
+      continue;
+    }
+    if (rows == 0) {
+      first = timestamps[0];
+    }
+    last = timestamps[timestamps.size - 1];
+    rows += timestamps.size;
+    // one column at a time, so each pass streams a contiguous array
+    for (int c = 1; c < kColumnCount; ++c) {
+      const Span<double> values = log.column(b, static_cast<ColumnarColumn>(c));
+      for (size_t k = 0; k < values.size; ++k) {
+        sum[c] += values[k];
+        max_abs[c] = fmax(max_abs[c], fabs(values[k]));
+      }
+    }
+  }
+  std::printf("%zu rows in %zu blocks over %.3f s\n", rows,
+              log.blocks() - bad_blocks, (last - first) * 1e-9);
+  if (bad_blocks) {
+    std::printf("corrupt blocks skipped: %zu\n", bad_blocks);
+  }
+  for (int c = 1; c < kColumnCount; ++c) {
+    std::printf("%-15s mean %12.6g  max_abs %12.6g\n", kColumnNames[c],
+                rows ? sum[c] / rows : 0.0, max_abs[c]);
+  }
+  return bad_blocks;
+}
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+  const bool summary = argc == 3 && std::strcmp(argv[1], "--summary") == 0;
+  if (argc != 2 && !summary) {
+    std::cerr << "usage: " << argv[0] << " [--summary] <log>" << std::endl;
+    return 1;
+  }
+  const char *path = argv[argc - 1];
+
+  ColumnarLogReader log;
+  if (!log.Open(path)) {
+    std::cerr << "cannot read " << path << std::endl;
+    return 1;
+  }
+  const size_t bad_blocks = summary ? Summarize(log) : Dump(log);
+  return bad_blocks == 0 ? 0 : 1;
+}
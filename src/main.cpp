@@ -1,133 +1,361 @@
 #include <uWS/uWS.h>
 #include <math.h>
-#include <fstream>
+#include <sys/stat.h>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
-#include "json.hpp"
-#include "PID.h"
-
-// for convenience
-using json = nlohmann::json;
+#include <string>
+#include <thread>
+#include <vector>
+#include "alloc_counter.h"
+#include "binary_protocol.h"
+#include "connection.h"
+#include "control_pipeline.h"
+#include "log.h"
+#include "socketio.h"
+#include "telemetry_recorder.h"
 
 // For converting back and forth between radians and degrees.
 constexpr double pi() { return M_PI; }
 double deg2rad(double x) { return x * pi() / 180; }
 double rad2deg(double x) { return x * 180 / pi(); }
 
-// Checks if the SocketIO event has JSON data.
-// If there is data the JSON object in string format will be returned,
-// else the empty string "" will be returned.
-std::string hasData(std::string s) {
-  auto found_null = s.find("null");
-  auto b1 = s.find_first_of("[");
-  auto b2 = s.find_last_of("]");
-  if (found_null != std::string::npos) {
-    return "";
-  }  else if (b1 != std::string::npos && b2 != std::string::npos) {
-    return s.substr(b1, b2 - b1 + 1);
+// Reloads the gain schedule file whenever its modification time changes and
+// publishes it to the control thread. Runs for the life of the process.
+void WatchGainSchedule(const std::string &path,
+                       Seqlock<GainSchedule> *tuning) {
+  time_t loaded_mtime = 0;
+  struct stat st;
+  if (stat(path.c_str(), &st) == 0) {
+    loaded_mtime = st.st_mtime;
+  }
+  while (true) {
+    std::this_thread::sleep_for(std::chrono::seconds(1));
+    if (stat(path.c_str(), &st) != 0 || st.st_mtime == loaded_mtime) {
+      continue;
+    }
+    loaded_mtime = st.st_mtime;
+    GainSchedule schedule;
+    if (schedule.Load(path)) {
+      tuning->Store(schedule);
+      std::cout << "Reloaded " << path << std::endl;
+    } else {
+      std::cerr << "Ignoring invalid " << path << std::endl;
+    }
   }
-  return "";
 }
 
-int main() {
-  // for debugging
-  // std::ofstream ofs ("pid_output.txt", std::ios::out | std::ios::trunc);
-  // ofs<<"cte "<<"delta_cte "<<"total_cte "<<"p_contrib "<<"d_contrib "<<
-  //      "i_contrib "<<"speed "<<"theta_to_desired_traj"<<std::endl<<std::endl;
-  // ofs.close();
+int main(int argc, char *argv[]) {
+  // --coalesce: when telemetry backs up, control only on the freshest frame
+  // and drop the stale ones. their cte still feeds the steering i term
+  //
+  // --no-skipped-integral: with --coalesce, let the freshest frame's cte
+  // stand in for the dropped frames' in the i term instead
+  //
+  // --text-log: record controller state as text in pid_output.txt instead
+  // of the columnar pid_output.log read by pid_log_dump
+  //
+  // --compress-log: deflate each block of pid_output.log
+  //
+  // --log-every N: print the per-frame debug lines for one frame in N
+  bool coalesce = false;
+  bool integrate_skipped_cte = true;
+  bool text_log = false;
+  bool compress_log = false;
+  uint32_t log_every = 1;
+  for (int k = 1; k < argc; ++k) {
+    if (std::strcmp(argv[k], "--coalesce") == 0) {
+      coalesce = true;
+    } else if (std::strcmp(argv[k], "--no-skipped-integral") == 0) {
+      integrate_skipped_cte = false;
+    } else if (std::strcmp(argv[k], "--text-log") == 0) {
+      text_log = true;
+    } else if (std::strcmp(argv[k], "--compress-log") == 0) {
+      compress_log = true;
+    } else if (std::strcmp(argv[k], "--log-every") == 0 && k + 1 < argc &&
+               std::atoi(argv[k + 1]) > 0) {
+      log_every = std::atoi(argv[++k]);
+    } else {
+      std::cerr << "usage: " << argv[0] <<
+                   " [--coalesce [--no-skipped-integral]]"
+                   " [--text-log | --compress-log] [--log-every N]" <<
+                   std::endl;
+      return -1;
+    }
+  }
 
   uWS::Hub h;
 
-  // dynamic target speed for speed pid - 60.0 is for the first calculation
-  // only. this will be a dynamic calculation of speed based on steering angle
-  double desired_speed = 60.0;
+  CarPipeline pipeline;
 
   // create and initialize steering pid for controlling steer angle
-  PID pid;
+  PID &pid = pipeline.steering.pid;
   pid.Init(0.237662, 0.000671427, 2.75795);
 
+  // steering gains by speed. without a schedule file the gains above are
+  // used at every speed
+  if (!pipeline.steering.schedule.Load("steering_gains.txt")) {
+    pipeline.steering.schedule.Add(0.0, pid.Kp, pid.Ki, pid.Kd);
+  }
+
+  // edits to the schedule file are picked up while driving
+  Seqlock<GainSchedule> steering_tuning;
+  pipeline.steering.tuning = &steering_tuning;
+  std::thread(WatchGainSchedule, std::string("steering_gains.txt"),
+              &steering_tuning).detach();
+
   // create and initialize speed pid for controlling throttle
-  PID speed_pid;
+  PID &speed_pid = pipeline.throttle.pid;
   speed_pid.Init(0.3, 0, 0.5);
 
-  h.onMessage([&pid, &speed_pid, &desired_speed](uWS::WebSocket<uWS::SERVER> ws,
+  // the simulator accepts steering and throttle in [-1, 1]. limiting the
+  // controllers to that range keeps the i terms from winding up while the
+  // output is pinned
+  pid.SetOutputLimits(-1.0, 1.0);
+  speed_pid.SetOutputLimits(-1.0, 1.0);
+
+  // the gains above were tuned at one update per telemetry frame. the
+  // simulator's frame interval (seconds) is measured when a connection
+  // starts, and replaces this value; from then on updates are scaled by each
+  // frame's own interval relative to it, so message jitter doesn't spike the
+  // d term or skew the i term
+  double telemetry_period = 0.05;
+  pid.SetSamplePeriod(telemetry_period);
+  speed_pid.SetSamplePeriod(telemetry_period);
+
+  // cutoff (Hz) of the low-pass filter on the steering d term, which keeps
+  // the large Kd from amplifying cte noise at high telemetry rates. 0 leaves
+  // the d term unfiltered
+  double steering_d_cutoff = 0.0;
+  pid.SetDerivativeFilter(steering_d_cutoff);
+
+  /*
+  * TUNABLE PARAMETERS
+  */
+
+  // used by speed_pid for target speed
+  pipeline.planner.max_speed = 45.0;
+
+  // for slowing down during turns
+  pipeline.planner.min_turn_speed = 35.0;
+
+  // for calculating amount to slow - will target min turn speed
+  // at/above this number
+  pipeline.planner.approx_max_steering_angle = 12.0;
+
+  // release gas instead of braking while the throttle is between this
+  // (negative) value and 0. 0 always brakes
+  pipeline.shaper.release_threshold = 0.0;
+
+  // per-message console output is formatted and written off the control
+  // thread
+  AsyncLogger logger(&std::cout);
+  LogSampler control_sampler(log_every);
+  LogSampler steer_sampler(log_every);
+
+  // controller state for every step, written off the control thread. the
+  // file rotates every 64 MB or hour of driving
+  RecordFormat record_format = kColumnarRecords;
+  if (text_log) {
+    record_format = kTextRecords;
+  } else if (compress_log) {
+    record_format = kDeflatedColumnarRecords;
+  }
+  TelemetryRecorder recorder(text_log ? "pid_output.txt" : "pid_output.log",
+                             record_format, 64 << 20, 3600);
+
+  // Sends a command back in the connection's protocol.
+  auto send = [&logger, &steer_sampler](uWS::WebSocket<uWS::SERVER> ws,
+                                        Connection *conn, const Command &c) {
+    if (conn->binary) {
+      size_t msg_length = WriteBinaryCommand(c, conn->sequence, conn->reply,
+                                             Connection::kReplyCapacity);
+      ws.send(conn->reply, msg_length, uWS::OpCode::BINARY);
+    } else {
+      size_t msg_length =
+          WriteSteerReply(c, conn->reply, Connection::kReplyCapacity);
+      PID_LOG_SAMPLED(DEBUG, steer_sampler, logger, kSteerRecord,
+                      c.steering_angle, c.throttle);
+      ws.send(conn->reply, msg_length, uWS::OpCode::TEXT);
+    }
+  };
+
+  // Runs the controller on one telemetry sample and sends the command back.
+  auto control = [&pipeline, &send, &logger, &control_sampler, &recorder](
+                     uWS::WebSocket<uWS::SERVER> ws, Connection *conn,
+                     const Telemetry &t) {
+    Command c = pipeline.Step(t);
+
+    PID_LOG_SAMPLED(DEBUG, control_sampler, logger, kControlRecord, t.cte,
+                    c.steering_angle);
+    const PID &pid = pipeline.steering.pid;
+    TelemetryRecord record;
+    record.timestamp =
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+    record.cte = t.cte;
+    record.speed = t.speed;
+    record.angle = t.angle;
+    record.steering_angle = c.steering_angle;
+    record.throttle = c.throttle;
+    record.delta_cte = pid.d_error;
+    record.total_cte = pid.i_error;
+    record.p_contrib = t.cte * pid.kp();
+    record.i_contrib = pid.i_error * pid.ki();
+    record.d_contrib = pid.d_error * pid.kd();
+    recorder.Record(record);
+
+    conn->last_command = c;
+    conn->has_command = true;
+    send(ws, conn, c);
+  };
+
+  // A frame that can't be decoded is counted and answered with the last good
+  // command, so the simulator keeps its current steering and throttle rather
+  // than waiting on a reply.
+  auto reject = [&send](uWS::WebSocket<uWS::SERVER> ws, Connection *conn,
+                        DecodeStatus status) {
+    switch (status) {
+      case kDecodeMalformed:
+        ++conn->decode_malformed;
+        break;
+      case kDecodeMissingField:
+        ++conn->decode_missing_field;
+        break;
+      case kDecodeOutOfRange:
+        ++conn->decode_out_of_range;
+        break;
+      case kDecodeOk:
+        return;
+    }
+    if (conn->has_command) {
+      send(ws, conn, conn->last_command);
+    }
+  };
+
+  // In coalescing mode telemetry is held back until the event loop has
+  // drained every frame already queued on the socket, then only the
+  // freshest frame of each connection is controlled on. The zero-delay
+  // timer fires after the current batch of reads.
+  std::vector<uWS::WebSocket<uWS::SERVER> > pending;
+  auto flush = [&pipeline, &pending, &control, integrate_skipped_cte]() {
+    for (size_t k = 0; k < pending.size(); ++k) {
+      uWS::WebSocket<uWS::SERVER> ws = pending[k];
+      Connection *conn = static_cast<Connection *>(ws.getUserData());
+      AllocationProbe probe(&conn->heap_allocations,
+                            &conn->allocating_messages);
+      // the fresh sample covers the whole interval since the last one
+      // controlled on, so the update integrates its cte over the skipped
+      // frames' share too (unless the interval is unknown or too long, when
+      // it counts one period). by default that share is swapped for the
+      // skipped frames' own integral; with integrate_skipped_cte false the
+      // fresh cte stands in for them
+      Telemetry t = conn->pending;
+      t.dt += conn->skipped_dt;
+      if (integrate_skipped_cte) {
+        PID &pid = pipeline.steering.pid;
+        const bool whole_interval =
+            t.dt > 0 && t.dt / pid.sample_period <= pid.max_steps;
+        pid.AddIntegral(conn->skipped_cte -
+                        (whole_interval ? t.cte * conn->skipped_steps : 0));
+      }
+      conn->skipped_dt = 0;
+      conn->skipped_steps = 0;
+      conn->skipped_cte = 0;
+      conn->has_pending = false;
+      control(ws, conn, t);
+    }
+    pending.clear();
+  };
+  uS::Timer *flush_timer = new uS::Timer(h.getLoop());
+  flush_timer->setData(&flush);
+
+  auto receive = [&pending, &control, &pipeline, &telemetry_period,
+                  steering_d_cutoff, coalesce, flush_timer](
+                     uWS::WebSocket<uWS::SERVER> ws, Connection *conn,
+                     Telemetry t) {
+    t.dt = conn->clock.Tick();
+    if (!conn->clock.calibrated()) {
+      // one nominal step per frame, as the gains were tuned, until the
+      // frame interval is known
+      t.dt = 0;
+    } else if (conn->clock.period() != telemetry_period) {
+      telemetry_period = conn->clock.period();
+      PID &pid = pipeline.steering.pid;
+      pid.SetSamplePeriod(telemetry_period);
+      pid.SetDerivativeFilter(steering_d_cutoff);
+      pipeline.throttle.pid.SetSamplePeriod(telemetry_period);
+    }
+    if (!coalesce) {
+      control(ws, conn, t);
+      return;
+    }
+    if (conn->has_pending) {
+      // integrate the superseded sample over its own interval, the way
+      // UpdateError(cte, dt) would have
+      const double dt = conn->pending.dt;
+      const double max_steps = pipeline.steering.pid.max_steps;
+      const double steps = dt > 0 && dt / telemetry_period <= max_steps
+                               ? dt / telemetry_period
+                               : 1.0;
+      ++conn->frames_dropped;
+      conn->skipped_dt += dt;
+      conn->skipped_steps += steps;
+      conn->skipped_cte += conn->pending.cte * steps;
+    } else {
+      if (pending.empty()) {
+        flush_timer->start([](uS::Timer *timer) {
+          (*static_cast<decltype(flush) *>(timer->getData()))();
+        }, 0, 0);
+      }
+      pending.push_back(ws);
+      conn->has_pending = true;
+    }
+    conn->pending = t;
+  };
+
+  h.onMessage([&receive, &reject](uWS::WebSocket<uWS::SERVER> ws,
                char *data, size_t length, uWS::OpCode opCode) {
+    Connection *conn = static_cast<Connection *>(ws.getUserData());
+    AllocationProbe probe(&conn->heap_allocations,
+                          &conn->allocating_messages);
+    if (conn->binary) {
+      Telemetry t = Telemetry();
+      DecodeStatus status =
+          opCode == uWS::OpCode::BINARY
+              ? DecodeBinaryTelemetry(data, length, &t, &conn->sequence)
+              : kDecodeMalformed;
+      if (status == kDecodeOk) {
+        receive(ws, conn, t);
+      } else {
+        reject(ws, conn, status);
+      }
+      return;
+    }
+
     // "42" at the start of the message means there's a websocket message event.
     // The 4 signifies a websocket message
     // The 2 signifies a websocket event
-    if (length && length > 2 && data[0] == '4' && data[1] == '2') {
-      auto s = hasData(std::string(data).substr(0, length));
-      if (s != "") {
-        auto j = json::parse(s);
-        std::string event = j[0].get<std::string>();
-        if (event == "telemetry") {
-          // debugging
-          std::ofstream ofs("pid_output.txt", std::ios::out | std::ios::app);
-
-          // j[1] is the data JSON object
-          double cte = std::stod(j[1]["cte"].get<std::string>());
-          double speed = std::stod(j[1]["speed"].get<std::string>());
-          double angle = std::stod(j[1]["steering_angle"].get<std::string>());
-          double steer_value;
-          double speed_error;
-          double throttle;
-
-          /*
-          * TUNABLE PARAMETERS
-          */
-
-          // used by speed_pid for target speed
-          double max_speed = 45.0;
-
-          // for slowing down during turns
-          double min_turn_speed = 35.0;
-
-          // for calculating amount to slow - will target min turn speed
-          // at/above this number
-          double approx_max_steering_angle = 12.0;
-
-          /*
-          * CALCULATE STEER VALUE
-          */
-
-          pid.UpdateError(cte);
-          steer_value = pid.TotalError();
-
-          /*
-          * CALCULATE THROTTLE
-          */
-
-          // slow down on turns
-          desired_speed = max_speed - (max_speed - min_turn_speed) *
-          fabs(angle/approx_max_steering_angle);
-          // dont go below min speed if angle is larger than approx max
-          if (desired_speed < min_turn_speed) {desired_speed = min_turn_speed;}
-          speed_error = speed - desired_speed;
-          speed_pid.UpdateError(speed_error);
-          throttle = speed_pid.TotalError();
-          // release gas instead of breaking if you go slightly over max_speed
-          // still break if steering angle requires slowing down
-          if ( (throttle < 0.0) && (throttle > (3*s[1])) ) {throttle = 0.0;}
-
-          // // DEBUG
-          std::cout << "CTE: " << cte << " Steering Value: " <<
-                       steer_value << std::endl;
-          // ofs<<"\r\n"<<cte<<" "<<pid.d_error<<" "<<pid.i_error<<
-          //      " "<<cte*pid.Kp<<" "<<
-          //      pid.d_error*pid.Kd<< " "<<pid.i_error*pid.Ki<< " "<<speed;
-          // ofs.close();
-
-          json msgJson;
-          msgJson["steering_angle"] = steer_value;
-          msgJson["throttle"] = throttle;
-          auto msg = "42[\"steer\"," + msgJson.dump() + "]";
-          std::cout << msg << std::endl;
-          ws.send(msg.data(), msg.length(), uWS::OpCode::TEXT);
+    Slice payload;
+    switch (ClassifyFrame(data, length, &payload)) {
+      case kTelemetryFrame: {
+        Telemetry t = Telemetry();
+        DecodeStatus status = DecodeTelemetry(payload, &t);
+        if (status == kDecodeOk) {
+          receive(ws, conn, t);
+        } else {
+          reject(ws, conn, status);
         }
-      } else {
-        // Manual driving
-        std::string msg = "42[\"manual\",{}]";
-        ws.send(msg.data(), msg.length(), uWS::OpCode::TEXT);
+        break;
       }
+      case kManualFrame:
+        // Manual driving
+        ws.send(kManualReply, sizeof(kManualReply) - 1, uWS::OpCode::TEXT);
+        break;
+      case kOtherEventFrame:
+      case kNotEventFrame:
+        break;
     }
   });
 
@@ -145,13 +373,54 @@ int main() {
   });
 
   h.onConnection([&h](uWS::WebSocket<uWS::SERVER> ws, uWS::HttpRequest req) {
-    std::cout << "Connected!!!" << std::endl;
+    // a fresh connection starts with a fresh clock, so the gap since the
+    // previous simulator run is never integrated
+    Connection *conn = new Connection;
+    // peers connecting to the binary protocol path skip socket.io entirely
+    uWS::Header url = req.getUrl();
+    conn->binary =
+        url.valueLength == sizeof(kBinaryProtocolPath) - 1 &&
+        std::memcmp(url.value, kBinaryProtocolPath, url.valueLength) == 0;
+    ws.setUserData(conn);
+    std::cout << "Connected!!!" << (conn->binary ? " (binary)" : "") <<
+                 std::endl;
   });
 
-  h.onDisconnection([&h](uWS::WebSocket<uWS::SERVER> ws, int code,
-                         char *message, size_t length) {
+  h.onDisconnection([&h, &pending, &pipeline, &recorder](
+                        uWS::WebSocket<uWS::SERVER> ws, int code,
+                        char *message, size_t length) {
+    Connection *conn = static_cast<Connection *>(ws.getUserData());
+    if (conn->has_pending) {
+      for (size_t k = 0; k < pending.size(); ++k) {
+        if (pending[k].getUserData() == conn) {
+          pending.erase(pending.begin() + k);
+          break;
+        }
+      }
+    }
+    std::cout << "Disconnected (" << conn->frames_dropped <<
+                 " stale frames dropped)" << std::endl;
+    std::cout << "Rejected telemetry: " << conn->decode_malformed <<
+                 " malformed, " << conn->decode_missing_field <<
+                 " missing a field, " << conn->decode_out_of_range <<
+                 " out of range" << std::endl;
+    // the controllers outlive connections, so these count since startup
+    const PID &pid = pipeline.steering.pid;
+    const PID &speed_pid = pipeline.throttle.pid;
+    std::cout << "Saturated updates: steering " << pid.saturation_count <<
+                 " (" << pid.windup_count << " held integration), speed " <<
+                 speed_pid.saturation_count << " (" <<
+                 speed_pid.windup_count << " held integration)" << std::endl;
+    std::cout << "Recorder: " << recorder.dropped() << " rows dropped, " <<
+                 recorder.lost_rows() << " rows (" << recorder.lost_bytes() <<
+                 " bytes) lost to write errors" << std::endl;
+    if (kCountingAllocations) {
+      std::cout << conn->heap_allocations << " heap allocations in " <<
+                   conn->allocating_messages << " messages" << std::endl;
+    }
+    delete conn;
+    ws.setUserData(NULL);
     ws.close();
-    std::cout << "Disconnected" << std::endl;
   });
 
   int port = 4567;
@@ -0,0 +1,130 @@
+#include "number_parser.h"
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+namespace {
+
+// Powers of ten that are exactly representable as doubles.
+const double kExactPowersOfTen[] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+const int kMaxExactPower = 22;
+
+// Largest integer below which every integer is an exact double.
+const uint64_t kMaxExactMantissa = uint64_t(1) << 53;
+
+const int kMaxMantissaDigits = 19;
+
+bool IsDigit(char c) { return c >= '0' && c <= '9'; }
+
+bool SlowParse(const char *first, const char *last, double *value) {
+  char stack_buffer[128];
+  std::string heap_buffer;
+  const size_t size = last - first;
+  char *buffer = stack_buffer;
+  // every digit can matter for rounding, so a number too long for the stack
+  // buffer is copied whole rather than truncated
+  if (size >= sizeof(stack_buffer)) {
+    heap_buffer.assign(first, size);
+    buffer = &heap_buffer[0];
+  } else {
+    std::memcpy(buffer, first, size);
+    buffer[size] = '\0';
+  }
+  char *parsed_end;
+  *value = std::strtod(buffer, &parsed_end);
+  return parsed_end == buffer + size;
+}
+
+}  // namespace
+
+bool ParseDouble(const char *first, const char *last, double *value) {
+  const char *p = first;
+  bool negative = false;
+  if (p != last && (*p == '-' || *p == '+')) {
+    negative = *p == '-';
+    ++p;
+  }
+
+  uint64_t mantissa = 0;
+  int digits = 0;
+  int exponent = 0;
+  bool any_digits = false;
+  bool overflow = false;
+
+  for (; p != last && IsDigit(*p); ++p) {
+    any_digits = true;
+    if (digits == 0 && *p == '0') {
+      continue;
+    }
+    if (digits < kMaxMantissaDigits) {
+      mantissa = mantissa * 10 + (*p - '0');
+      ++digits;
+    } else {
+      overflow = true;
+      ++exponent;
+    }
+  }
+  if (p != last && *p == '.') {
+    ++p;
+    for (; p != last && IsDigit(*p); ++p) {
+      any_digits = true;
+      if (digits == 0 && *p == '0') {
+        --exponent;
+        continue;
+      }
+      if (digits < kMaxMantissaDigits) {
+        mantissa = mantissa * 10 + (*p - '0');
+        ++digits;
+        --exponent;
+      } else {
+        overflow = true;
+      }
+    }
+  }
+  if (!any_digits) {
+    return false;
+  }
+  if (p != last && (*p == 'e' || *p == 'E')) {
+    ++p;
+    bool negative_exponent = false;
+    if (p != last && (*p == '-' || *p == '+')) {
+      negative_exponent = *p == '-';
+      ++p;
+    }
+    if (p == last || !IsDigit(*p)) {
+      return false;
+    }
+    int explicit_exponent = 0;
+    for (; p != last && IsDigit(*p); ++p) {
+      if (explicit_exponent < 100000) {
+        explicit_exponent = explicit_exponent * 10 + (*p - '0');
+      }
+    }
+    exponent += negative_exponent ? -explicit_exponent : explicit_exponent;
+  }
+  if (p != last) {
+    return false;
+  }
+
+  if (mantissa == 0 && !overflow) {
+    *value = negative ? -0.0 : 0.0;
+    return true;
+  }
+  // Clinger's fast path: both operands are exact, so the single rounding
+  // of the multiply or divide gives the correctly rounded result.
+  if (!overflow && mantissa <= kMaxExactMantissa &&
+      exponent >= -kMaxExactPower && exponent <= kMaxExactPower) {
+    double result = static_cast<double>(mantissa);
+    if (exponent < 0) {
+      result /= kExactPowersOfTen[-exponent];
+    } else {
+      result *= kExactPowersOfTen[exponent];
+    }
+    *value = negative ? -result : result;
+    return true;
+  }
+  return SlowParse(first, last, value);
+}
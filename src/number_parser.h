@@ -0,0 +1,18 @@
+#ifndef NUMBER_PARSER_H
+#define NUMBER_PARSER_H
+
+/*
+* Parse the decimal number in [first, last) into *value. The whole range
+* must be a number: an optional sign, digits with an optional fraction, and
+* an optional exponent. The result is the correctly rounded double, the
+* same as strtod returns.
+*
+* Numbers with at most 19 significant digits whose value is an exact double
+* scaled by an exact power of ten (every field the simulator sends) are
+* converted with a single multiply or divide, without allocating or touching
+* the locale. Anything else falls back to strtod on a copy, on the stack
+* unless the number is over 127 characters long.
+*/
+bool ParseDouble(const char *first, const char *last, double *value);
+
+#endif /* NUMBER_PARSER_H */
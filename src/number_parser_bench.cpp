@@ -0,0 +1,64 @@
+// Times ParseDouble against strtod on the numbers the simulator sends.
+//
+// usage: pid_number_parser_bench [iterations]
+//
+// The inputs are cte, speed and steering angle values printed the way the
+// simulator prints them (four decimals). strtod is given a NUL-terminated
+// copy, as the decoder would have to make for it.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "bench.h"
+#include "number_parser.h"
+
+int main(int argc, char *argv[]) {
+  const long iterations = Iterations(argc, argv, 10000000);
+
+  std::vector<std::string> inputs;
+  for (int k = 0; k < 1024; ++k) {
+    const Telemetry t = SampleTelemetry(k);
+    char text[32];
+    std::snprintf(text, sizeof(text), "%.4f", t.cte + k * 1e-7);
+    inputs.push_back(text);
+    std::snprintf(text, sizeof(text), "%.4f", t.speed);
+    inputs.push_back(text);
+    std::snprintf(text, sizeof(text), "%.4f", t.angle);
+    inputs.push_back(text);
+  }
+
+  const size_t n = inputs.size();
+  const double parse_seconds = BestSeconds([&]() {
+    double sum = 0;
+    size_t i = 0;
+    for (long k = 0; k < iterations; ++k) {
+      const std::string &s = inputs[i];
+      i = i + 1 == n ? 0 : i + 1;
+      double value;
+      ParseDouble(s.data(), s.data() + s.size(), &value);
+      sum += value;
+    }
+    Consume(sum);
+  });
+  const double strtod_seconds = BestSeconds([&]() {
+    double sum = 0;
+    size_t i = 0;
+    for (long k = 0; k < iterations; ++k) {
+      const std::string &s = inputs[i];
+      i = i + 1 == n ? 0 : i + 1;
+      char buffer[128];
+      std::memcpy(buffer, s.data(), s.size());
+      buffer[s.size()] = '\0';
+      sum += std::strtod(buffer, NULL);
+    }
+    Consume(sum);
+  });
+
+  std::printf("ParseDouble %6.1f ns/number\n",
+              parse_seconds * 1e9 / iterations);
+  std::printf("strtod      %6.1f ns/number\n",
+              strtod_seconds * 1e9 / iterations);
+  return 0;
+}
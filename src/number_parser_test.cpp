@@ -0,0 +1,138 @@
+// Checks ParseDouble against strtod, bit for bit.
+//
+// usage: pid_number_parser_test [iterations]
+//
+// Covers hand-picked edge cases (signed zero, subnormals, overflow,
+// rounding halfway cases, numbers too long for the stack copy), random
+// doubles printed in every %g/%e precision, and random digit strings with
+// random exponents. Exits non-zero on the first few mismatches.
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include "bench.h"
+#include "number_parser.h"
+
+namespace {
+
+uint64_t Next(uint64_t *state) {
+  *state ^= *state << 13;
+  *state ^= *state >> 7;
+  *state ^= *state << 17;
+  return *state;
+}
+
+long checked = 0;
+long mismatches = 0;
+
+void Check(const std::string &text) {
+  ++checked;
+  char *end;
+  const double expected = std::strtod(text.c_str(), &end);
+  double actual = 0;
+  const bool parsed =
+      ParseDouble(text.data(), text.data() + text.size(), &actual);
+  if (!parsed || std::memcmp(&actual, &expected, sizeof(actual)) != 0) {
+    if (++mismatches <= 10) {
+      std::printf("mismatch on \"%s\": strtod %.17g, ParseDouble %s%.17g\n",
+                  text.c_str(), expected, parsed ? "" : "(rejected) ",
+                  actual);
+    }
+  }
+}
+
+void CheckRejected(const char *text) {
+  ++checked;
+  double value;
+  if (ParseDouble(text, text + std::strlen(text), &value)) {
+    ++mismatches;
+    std::printf("accepted invalid \"%s\"\n", text);
+  }
+}
+
+void EdgeCases() {
+  const char *const cases[] = {
+      "0", "-0", "0.0", "-0.0", "0e10", "1", "-1", "0.1", "0.2", "0.3",
+      "1e22", "1e23", "-1e22", "1e-22", "1e-23", "9007199254740992",
+      "9007199254740993", "9007199254740993.0000000001", "18446744073709551615",
+      "18446744073709551616", "123456789012345678901234567890",
+      "2.2250738585072011e-308", "2.2250738585072012e-308",
+      "2.2250738585072014e-308", "4.9406564584124654e-324", "5e-324",
+      "2.4703282292062327e-324", "2.4703282292062328e-324",
+      "1.7976931348623157e308", "1.7976931348623158e308",
+      "1.7976931348623159e308", "1e308", "1e309", "-1e400", "1e-400",
+      "0.000000000000000000000000000001", "1E5", "1e+5", "+1.5", "00012",
+      "1.", ".5", "7.2e-0",
+  };
+  for (size_t k = 0; k < sizeof(cases) / sizeof(cases[0]); ++k) {
+    Check(cases[k]);
+  }
+  // halfway between two doubles until a digit far past the stack copy's
+  // 127 characters tips it
+  Check("9007199254740993." + std::string(200, '0') + "1");
+  Check("9007199254740993." + std::string(200, '0'));
+  Check("0." + std::string(400, '0') + "1e400");
+  Check(std::string(310, '9'));
+
+  const char *const invalid[] = {"", "-", "+", ".", "e5", "1e", "1e+",
+                                 "1.2.3", "1e5.0", "--1", "0x10", "inf",
+                                 "nan", "1 ", " 1", "1f"};
+  for (size_t k = 0; k < sizeof(invalid) / sizeof(invalid[0]); ++k) {
+    CheckRejected(invalid[k]);
+  }
+}
+
+void RandomDoubles(long iterations) {
+  uint64_t state = 88172645463325252ULL;
+  char text[64];
+  for (long k = 0; k < iterations; ++k) {
+    uint64_t bits = Next(&state);
+    double value;
+    std::memcpy(&value, &bits, sizeof(value));
+    if (value != value || value - value != 0) {
+      continue;  // NaN or infinite
+    }
+    const int precision = 1 + Next(&state) % 17;
+    std::snprintf(text, sizeof(text), k % 2 ? "%.*g" : "%.*e", precision,
+                  value);
+    Check(text);
+  }
+}
+
+void RandomDigits(long iterations) {
+  uint64_t state = 0x9E3779B97F4A7C15ULL;
+  for (long k = 0; k < iterations; ++k) {
+    std::string text;
+    if (Next(&state) % 2) {
+      text += '-';
+    }
+    const int digits = 1 + Next(&state) % 25;
+    const int point = Next(&state) % (digits + 1);
+    for (int d = 0; d < digits; ++d) {
+      if (d == point && d > 0) {
+        text += '.';
+      }
+      text += static_cast<char>('0' + Next(&state) % 10);
+    }
+    if (Next(&state) % 2) {
+      char exponent[16];
+      std::snprintf(exponent, sizeof(exponent), "e%d",
+                    static_cast<int>(Next(&state) % 701) - 350);
+      text += exponent;
+    }
+    Check(text);
+  }
+}
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+  const long iterations = Iterations(argc, argv, 1000000);
+  EdgeCases();
+  RandomDoubles(iterations);
+  RandomDigits(iterations);
+  std::printf("%ld inputs, %ld mismatches\n", checked, mismatches);
+  return mismatches == 0 ? 0 : 1;
+}
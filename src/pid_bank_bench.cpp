@@ -0,0 +1,146 @@
+// Times BasicPIDBank against an array of scalar PIDs and checks that both
+// produce the same outputs bit for bit.
+//
+// usage: pid_bank_bench [steps]
+//
+// Each step feeds one cte per controller to 1024 controllers with distinct
+// gains, through PIDBank::Step and through UpdateError and TotalError on
+// every PID. Then scores 4096 candidate gain sets against one controller's
+// error state, through EvaluateGainCandidates and through TotalError on a
+// PID per candidate. Exits non-zero if any output differs.
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include "PID.h"
+#include "PIDBank.h"
+#include "bench.h"
+
+namespace {
+
+const size_t kControllers = 1024;
+const size_t kCandidates = 4096;
+
+// cte of controller k at step s, deterministic and cheap next to the update
+double Cte(size_t k, long s) {
+  return 0.001 * static_cast<double>((k * 7919 + s * 104729) % 2001) - 1.0;
+}
+
+void InitGains(size_t k, double *kp, double *ki, double *kd) {
+  *kp = 0.1 + 0.0003 * k;
+  *ki = 0.0001 + 0.000001 * k;
+  *kd = 1.0 + 0.002 * k;
+}
+
+// Scores every candidate gain set against pid's error state both ways.
+// Returns the number of candidates whose scores differ.
+long SweepCandidates(const PID &pid, long sweeps) {
+  std::vector<double> gains(3 * kCandidates);
+  std::vector<PID> candidates(kCandidates);
+  for (size_t k = 0; k < kCandidates; ++k) {
+    InitGains(k, &gains[3 * k], &gains[3 * k + 1], &gains[3 * k + 2]);
+    candidates[k].Init(gains[3 * k], gains[3 * k + 1], gains[3 * k + 2]);
+    candidates[k].p_error = pid.p_error;
+    candidates[k].i_error = pid.i_error;
+    candidates[k].d_error = pid.d_error;
+  }
+
+  std::vector<double> sweep_out(kCandidates), scalar_out(kCandidates);
+  EvaluateGainCandidates(pid, gains.data(), kCandidates, sweep_out.data());
+  long mismatches = 0;
+  for (size_t k = 0; k < kCandidates; ++k) {
+    scalar_out[k] = candidates[k].TotalError();
+    if (std::memcmp(&sweep_out[k], &scalar_out[k], sizeof(double)) != 0) {
+      ++mismatches;
+    }
+  }
+  std::printf("%ld of %zu candidates differ\n", mismatches, kCandidates);
+
+  const double sweep_seconds = BestSeconds([&]() {
+    for (long s = 0; s < sweeps; ++s) {
+      EvaluateGainCandidates(pid, gains.data(), kCandidates, sweep_out.data());
+      Consume(sweep_out[s % kCandidates]);
+    }
+  });
+  const double scalar_seconds = BestSeconds([&]() {
+    for (long s = 0; s < sweeps; ++s) {
+      for (size_t k = 0; k < kCandidates; ++k) {
+        scalar_out[k] = candidates[k].TotalError();
+      }
+      Consume(scalar_out[s % kCandidates]);
+    }
+  });
+  const double scored = static_cast<double>(sweeps) * kCandidates;
+  std::printf("EvaluateGainCandidates %8.1f M candidates/s\n",
+              scored / sweep_seconds * 1e-6);
+  std::printf("scalar TotalError      %8.1f M candidates/s\n",
+              scored / scalar_seconds * 1e-6);
+  return mismatches;
+}
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+  const long steps = Iterations(argc, argv, 20000);
+
+  // every step's input, generated up front so neither loop pays for it
+  const long distinct = steps < 256 ? steps : 256;
+  std::vector<double> inputs(distinct * kControllers);
+  for (long s = 0; s < distinct; ++s) {
+    for (size_t k = 0; k < kControllers; ++k) {
+      inputs[s * kControllers + k] = Cte(k, s);
+    }
+  }
+
+  // bit-identity over the full run
+  PIDBank bank;
+  std::vector<PID> pids(kControllers);
+  for (size_t k = 0; k < kControllers; ++k) {
+    double kp, ki, kd;
+    InitGains(k, &kp, &ki, &kd);
+    bank.Add(kp, ki, kd);
+    pids[k].Init(kp, ki, kd);
+  }
+  std::vector<double> bank_out(kControllers), scalar_out(kControllers);
+  long mismatches = 0;
+  for (long s = 0; s < steps; ++s) {
+    const double *cte = &inputs[(s % distinct) * kControllers];
+    bank.Step(cte, bank_out.data());
+    for (size_t k = 0; k < kControllers; ++k) {
+      pids[k].UpdateError(cte[k]);
+      scalar_out[k] = pids[k].TotalError();
+    }
+    if (std::memcmp(bank_out.data(), scalar_out.data(),
+                    kControllers * sizeof(double)) != 0) {
+      ++mismatches;
+    }
+  }
+  std::printf("%ld of %ld steps differ\n", mismatches, steps);
+
+  const double bank_seconds = BestSeconds([&]() {
+    for (long s = 0; s < steps; ++s) {
+      bank.Step(&inputs[(s % distinct) * kControllers], bank_out.data());
+      Consume(bank_out[0]);
+    }
+  });
+  const double scalar_seconds = BestSeconds([&]() {
+    for (long s = 0; s < steps; ++s) {
+      const double *cte = &inputs[(s % distinct) * kControllers];
+      for (size_t k = 0; k < kControllers; ++k) {
+        pids[k].UpdateError(cte[k]);
+        scalar_out[k] = pids[k].TotalError();
+      }
+      Consume(scalar_out[0]);
+    }
+  });
+
+  const double controller_steps = static_cast<double>(steps) * kControllers;
+  std::printf("PIDBank::Step %8.1f M controller-steps/s\n",
+              controller_steps / bank_seconds * 1e-6);
+  std::printf("scalar PID    %8.1f M controller-steps/s\n",
+              controller_steps / scalar_seconds * 1e-6);
+
+  const long candidate_mismatches = SweepCandidates(pids[0], steps / 4 + 1);
+  return mismatches == 0 && candidate_mismatches == 0 ? 0 : 1;
+}
@@ -0,0 +1,144 @@
+// Compares the steering output of the float and Q16.16 PID backends against
+// the double reference over a recorded telemetry trace.
+//
+// usage: pid_precision_report <trace> [Kp Ki Kd]
+//
+// The trace is either a columnar log written by TelemetryRecorder, whose cte
+// column is used, or the pid_output.txt text format: one sample per line
+// with the cte in the first column. Lines that don't start with a number
+// are skipped, and so are columnar blocks that fail to inflate.
+
+#include <math.h>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "PID.h"
+#include "columnar_log.h"
+#include "fixed_point.h"
+
+namespace {
+
+struct Accuracy {
+  double max_error;
+  double sum_sq_error;
+  size_t worst_sample;
+  size_t sign_flips;
+};
+
+template <typename Scalar>
+Accuracy Compare(const std::vector<double> &trace,
+                 const std::vector<double> &reference, double Kp, double Ki,
+                 double Kd) {
+  BasicPID<Scalar> pid;
+  pid.Init(Scalar(Kp), Scalar(Ki), Scalar(Kd));
+  pid.SetOutputLimits(Scalar(-1.0), Scalar(1.0));
+
+  Accuracy a = {0, 0, 0, 0};
+  for (size_t k = 0; k < trace.size(); ++k) {
+    pid.UpdateError(Scalar(trace[k]));
+    const double steer = static_cast<double>(pid.TotalError());
+    const double error = fabs(steer - reference[k]);
+    if (error > a.max_error) {
+      a.max_error = error;
+      a.worst_sample = k;
+    }
+    a.sum_sq_error += error * error;
+    if ((steer < 0) != (reference[k] < 0) && steer != 0 && reference[k] != 0) {
+      ++a.sign_flips;
+    }
+  }
+  return a;
+}
+
+// Reads the cte column of a columnar log. Returns false if path isn't one.
+bool ReadColumnarTrace(const char *path, std::vector<double> *trace) {
+  ColumnarLogReader log;
+  if (!log.Open(path)) {
+    return false;
+  }
+  trace->reserve(log.rows());
+  for (size_t b = 0; b < log.blocks(); ++b) {
+    if (!log.readable(b)) {
+      std::cerr << "skipping corrupt block " << b << std::endl;
+      continue;
+    }
+    const Span<double> cte = log.column(b, kColumnCte);
+    trace->insert(trace->end(), cte.begin(), cte.end());
+  }
+  return true;
+}
+
+// Reads the first column of a text trace. Returns false if path can't be
+// opened.
+bool ReadTextTrace(const char *path, std::vector<double> *trace) {
+  std::ifstream in(path);
+  if (!in) {
+    return false;
+  }
+  std::string line;
+  while (std::getline(in, line)) {
+    std::istringstream fields(line);
+    double cte;
+    if (fields >> cte) {
+      trace->push_back(cte);
+    }
+  }
+  return true;
+}
+
+void Print(const char *name, const Accuracy &a, size_t samples) {
+  std::printf("%-8s max_abs_error %.3e (sample %zu)  rms_error %.3e  "
+              "sign_flips %zu\n",
+              name, a.max_error, a.worst_sample,
+              sqrt(a.sum_sq_error / samples), a.sign_flips);
+}
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+  if (argc != 2 && argc != 5) {
+    std::cerr << "usage: " << argv[0] << " <trace> [Kp Ki Kd]" << std::endl;
+    return 1;
+  }
+
+  // default to the steering gains used in main.cpp
+  double Kp = 0.237662;
+  double Ki = 0.000671427;
+  double Kd = 2.75795;
+  if (argc == 5) {
+    Kp = std::atof(argv[2]);
+    Ki = std::atof(argv[3]);
+    Kd = std::atof(argv[4]);
+  }
+
+  std::vector<double> trace;
+  if (!ReadColumnarTrace(argv[1], &trace) &&
+      !ReadTextTrace(argv[1], &trace)) {
+    std::cerr << "cannot open " << argv[1] << std::endl;
+    return 1;
+  }
+  if (trace.empty()) {
+    std::cerr << "no samples in " << argv[1] << std::endl;
+    return 1;
+  }
+
+  PID reference_pid;
+  reference_pid.Init(Kp, Ki, Kd);
+  reference_pid.SetOutputLimits(-1.0, 1.0);
+  std::vector<double> reference;
+  reference.reserve(trace.size());
+  for (size_t k = 0; k < trace.size(); ++k) {
+    reference_pid.UpdateError(trace[k]);
+    reference.push_back(reference_pid.TotalError());
+  }
+
+  std::printf("%zu samples, Kp %g Ki %g Kd %g\n", trace.size(), Kp, Ki, Kd);
+  Print("float", Compare<float>(trace, reference, Kp, Ki, Kd), trace.size());
+  Print("q16.16", Compare<Fixed16>(trace, reference, Kp, Ki, Kd),
+        trace.size());
+  return 0;
+}
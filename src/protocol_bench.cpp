@@ -0,0 +1,170 @@
+// Measures telemetry-to-command round-trip latency in the socket.io text
+// protocol and in the binary protocol, over a local socket.
+//
+// usage: pid_protocol_bench [round trips]
+//
+// One thread plays both ends of a SOCK_SEQPACKET socketpair, which keeps
+// message boundaries the way websocket frames do. Each round trip the
+// simulator side encodes a telemetry frame and sends it; the controller
+// side receives it, decodes it, steps a PID, encodes the command and sends
+// it back; the simulator side receives and decodes the command. Websocket
+// framing and the uWS event loop are left out, so the difference between
+// the two modes is what the protocols themselves cost. Exits non-zero if a
+// frame fails to decode.
+
+#include <sys/socket.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "PID.h"
+#include "bench.h"
+#include "binary_protocol.h"
+#include "number_parser.h"
+#include "socketio.h"
+
+namespace {
+
+const size_t kBufferSize = 4096;
+
+struct Endpoints {
+  int simulator;
+  int controller;
+};
+
+Command Control(PID *pid, const Telemetry &t) {
+  pid->UpdateError(t.cte);
+  Command c;
+  c.steering_angle = pid->TotalError();
+  c.throttle = 0.3;
+  return c;
+}
+
+// The number following "key": in a steer reply.
+bool FindNumber(Slice payload, const char *key, double *value) {
+  const size_t key_length = std::strlen(key);
+  const char *end = payload.end();
+  const char *p = std::search(payload.begin(), end, key, key + key_length);
+  if (p == end) {
+    return false;
+  }
+  const char *first = p + key_length;
+  const char *last = first;
+  while (last != end && *last != ',' && *last != '}') {
+    ++last;
+  }
+  return ParseDouble(first, last, value);
+}
+
+bool TextRoundTrip(const Endpoints &fds, PID *pid, long k, char *buffer) {
+  const std::string frame = TelemetryFrame(k, 0);
+  int length = static_cast<int>(frame.size());
+  if (write(fds.simulator, frame.data(), length) != length) {
+    return false;
+  }
+
+  ssize_t received = read(fds.controller, buffer, kBufferSize);
+  Slice payload;
+  Telemetry t = Telemetry();
+  if (received <= 0 ||
+      ClassifyFrame(buffer, received, &payload) != kTelemetryFrame ||
+      DecodeTelemetry(payload, &t) != kDecodeOk) {
+    return false;
+  }
+  length = WriteSteerReply(Control(pid, t), buffer, kBufferSize);
+  if (write(fds.controller, buffer, length) != length) {
+    return false;
+  }
+
+  received = read(fds.simulator, buffer, kBufferSize);
+  Command c;
+  return received > 0 && ExtractPayload(buffer, received, &payload) &&
+         FindNumber(payload, "\"steering_angle\":", &c.steering_angle) &&
+         FindNumber(payload, "\"throttle\":", &c.throttle);
+}
+
+bool BinaryRoundTrip(const Endpoints &fds, PID *pid, long k, char *buffer) {
+  const uint32_t sequence = static_cast<uint32_t>(k);
+  size_t length =
+      WriteBinaryTelemetry(SampleTelemetry(k), sequence, buffer, kBufferSize);
+  if (write(fds.simulator, buffer, length) != static_cast<ssize_t>(length)) {
+    return false;
+  }
+
+  ssize_t received = read(fds.controller, buffer, kBufferSize);
+  Telemetry t = Telemetry();
+  uint32_t echoed;
+  if (received <= 0 ||
+      DecodeBinaryTelemetry(buffer, received, &t, &echoed) != kDecodeOk) {
+    return false;
+  }
+  length = WriteBinaryCommand(Control(pid, t), echoed, buffer, kBufferSize);
+  if (write(fds.controller, buffer, length) !=
+      static_cast<ssize_t>(length)) {
+    return false;
+  }
+
+  received = read(fds.simulator, buffer, kBufferSize);
+  Command c;
+  return received > 0 &&
+         DecodeBinaryCommand(buffer, received, &c, &echoed) &&
+         echoed == sequence;
+}
+
+// Runs round_trips round trips and prints latency percentiles. Returns
+// false if any of them failed.
+template <typename RoundTrip>
+bool Measure(const char *name, RoundTrip round_trip, long round_trips) {
+  Endpoints fds;
+  int pair[2];
+  if (socketpair(AF_UNIX, SOCK_SEQPACKET, 0, pair) != 0) {
+    std::perror("socketpair");
+    return false;
+  }
+  fds.simulator = pair[0];
+  fds.controller = pair[1];
+
+  PID pid;
+  pid.Init(0.237662, 0.000671427, 2.75795);
+  std::vector<char> buffer(kBufferSize);
+  std::vector<double> nanoseconds;
+  nanoseconds.reserve(round_trips);
+  long failures = 0;
+  for (long k = 0; k < round_trips; ++k) {
+    const std::chrono::steady_clock::time_point start =
+        std::chrono::steady_clock::now();
+    if (!round_trip(fds, &pid, k, buffer.data())) {
+      ++failures;
+    }
+    nanoseconds.push_back(std::chrono::duration<double, std::nano>(
+        std::chrono::steady_clock::now() - start).count());
+  }
+  close(fds.simulator);
+  close(fds.controller);
+
+  std::sort(nanoseconds.begin(), nanoseconds.end());
+  std::printf("%-6s p50 %7.0f ns, p99 %7.0f ns", name,
+              nanoseconds[nanoseconds.size() / 2],
+              nanoseconds[nanoseconds.size() * 99 / 100]);
+  if (failures) {
+    std::printf(", %ld round trips FAILED", failures);
+  }
+  std::printf("\n");
+  return failures == 0;
+}
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+  const long round_trips = Iterations(argc, argv, 200000);
+  if (round_trips <= 0) {
+    return 1;
+  }
+  bool ok = true;
+  ok &= Measure("text", TextRoundTrip, round_trips);
+  ok &= Measure("binary", BinaryRoundTrip, round_trips);
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,165 @@
+// Replays synthetic telemetry through the dt-aware PID update and checks
+// that it keeps the behaviour the gains were tuned for.
+//
+// usage: pid_replay_test
+//
+// - at a constant dt equal to the sample period, UpdateError(cte, dt) must
+//   match UpdateError(cte) bit for bit
+// - with the interval jittered by up to +-50%, the output must stay close
+//   to the continuous-time output the gains imply at the nominal period
+// - a pause far longer than the period must integrate no more than one
+//   period's worth of cte
+// - re-applying unchanged gains every step, as the gain-scheduled pipeline
+//   does, must not disturb the integral
+//
+// Exits non-zero if any check fails.
+
+#include <math.h>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+#include "PID.h"
+
+namespace {
+
+// steering gains and telemetry interval used in main.cpp
+const double kKp = 0.237662;
+const double kKi = 0.000671427;
+const double kKd = 2.75795;
+const double kPeriod = 0.05;
+
+// cte of a car weaving around the lane center, in meters
+double Cte(double t) { return 0.8 * sin(0.7 * t) + 0.3 * sin(2.3 * t); }
+double CteRate(double t) {
+  return 0.8 * 0.7 * cos(0.7 * t) + 0.3 * 2.3 * cos(2.3 * t);
+}
+double CteIntegral(double t) {
+  return 0.8 / 0.7 * (1 - cos(0.7 * t)) + 0.3 / 2.3 * (1 - cos(2.3 * t));
+}
+
+// uniform in [0, 1), deterministic across runs
+double Uniform(uint64_t *state) {
+  *state = *state * 6364136223846793005ULL + 1442695040888963407ULL;
+  return (*state >> 11) * (1.0 / 9007199254740992.0);
+}
+
+void InitPid(PID *pid) {
+  pid->Init(kKp, kKi, kKd);
+  pid->SetOutputLimits(-1.0, 1.0);
+  pid->SetSamplePeriod(kPeriod);
+}
+
+bool Check(bool ok, const char *name) {
+  std::printf("%-40s %s\n", name, ok ? "ok" : "FAILED");
+  return ok;
+}
+
+bool ConstantDtMatchesPerFrameUpdate() {
+  PID per_frame, timed;
+  InitPid(&per_frame);
+  InitPid(&timed);
+  size_t mismatches = 0;
+  for (int k = 0; k < 100000; ++k) {
+    const double cte = Cte(k * kPeriod);
+    per_frame.UpdateError(cte);
+    timed.UpdateError(cte, kPeriod);
+    if (per_frame.TotalError() != timed.TotalError() ||
+        per_frame.i_error != timed.i_error) {
+      ++mismatches;
+    }
+  }
+  std::printf("  %zu of 100000 steps differ\n", mismatches);
+  return Check(mismatches == 0, "constant dt is bit-identical");
+}
+
+bool JitteredDtTracksNominal() {
+  PID timed, per_frame;
+  InitPid(&timed);
+  InitPid(&per_frame);
+  uint64_t rng = 1;
+  double t = 0;
+  double worst_timed = 0, worst_per_frame = 0;
+  for (int k = 0; k < 100000; ++k) {
+    const double dt = kPeriod * (0.5 + Uniform(&rng));
+    t += dt;
+    timed.UpdateError(Cte(t), dt);
+    per_frame.UpdateError(Cte(t));
+    // what the gains mean at the nominal period: the derivative and
+    // integral expressed per period. the backward difference lags that by
+    // about half a step, up to ~0.01 here. skip the derivative's first step,
+    // which differences against the zero initial state
+    const double nominal =
+        -kKp * Cte(t) - kKd * CteRate(t) * kPeriod -
+        kKi * CteIntegral(t) / kPeriod;
+    if (k > 0) {
+      worst_timed = fmax(worst_timed, fabs(timed.TotalError() - nominal));
+      worst_per_frame =
+          fmax(worst_per_frame, fabs(per_frame.TotalError() - nominal));
+    }
+  }
+  std::printf("  max deviation from nominal: dt-scaled %.4f, per-frame %.4f\n",
+              worst_timed, worst_per_frame);
+  return Check(worst_timed < 0.02 && worst_timed < worst_per_frame / 4,
+               "jittered dt stays on the nominal output");
+}
+
+bool PauseIntegratesOnePeriod() {
+  PID pid;
+  InitPid(&pid);
+  for (int k = 0; k < 100; ++k) {
+    pid.UpdateError(0.5, kPeriod);
+  }
+  const double before = pid.i_error;
+  // the simulator was paused for a minute
+  pid.UpdateError(0.5, 60.0);
+  const double increment = pid.i_error - before;
+  std::printf("  i_error grew by %g over a 60 s gap\n", increment);
+  return Check(fabs(increment - 0.5) < 1e-12, "a pause integrates one period");
+}
+
+bool UnchangedGainsKeepIntegral() {
+  PID plain, regained;
+  InitPid(&plain);
+  InitPid(&regained);
+  size_t mismatches = 0;
+  for (int k = 0; k < 100000; ++k) {
+    const double cte = Cte(k * kPeriod);
+    plain.UpdateError(cte, kPeriod);
+    regained.UpdateGains(kKp, kKi, kKd);
+    regained.UpdateError(cte, kPeriod);
+    if (plain.i_error != regained.i_error ||
+        plain.TotalError() != regained.TotalError()) {
+      ++mismatches;
+    }
+  }
+  std::printf("  %zu of 100000 steps differ\n", mismatches);
+  return Check(mismatches == 0, "unchanged gains keep the integral");
+}
+
+// A coalesced flush adds the skipped frames' integral, then updates: the
+// saturation counters must count that as the one step it is.
+bool FlushCountsSaturationOnce() {
+  PID pid;
+  InitPid(&pid);
+  pid.SetOutputLimits(-0.1, 0.1);
+  for (int k = 0; k < 100; ++k) {
+    pid.AddIntegral(2 * 5.0);
+    pid.UpdateError(5.0, 3 * kPeriod);
+  }
+  std::printf("  %lu saturated, %lu held over 100 saturated flushes\n",
+              pid.saturation_count, pid.windup_count);
+  return Check(pid.saturation_count == 100 && pid.windup_count == 100,
+               "a flush counts saturation once");
+}
+
+}  // namespace
+
+int main() {
+  bool ok = true;
+  ok &= ConstantDtMatchesPerFrameUpdate();
+  ok &= JitteredDtTracksNominal();
+  ok &= PauseIntegratesOnePeriod();
+  ok &= UnchangedGainsKeepIntegral();
+  ok &= FlushCountsSaturationOnce();
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,69 @@
+#ifndef SAMPLE_CLOCK_H
+#define SAMPLE_CLOCK_H
+
+#include <algorithm>
+#include <chrono>
+
+/*
+* Measures the interval between successive samples on a monotonic clock,
+* and the nominal sample period: the median of the first
+* kCalibrationSamples positive intervals, which a pause or a burst during
+* calibration doesn't skew.
+*/
+class SampleClock {
+ public:
+  static const int kCalibrationSamples = 16;
+
+  SampleClock() { Reset(); }
+
+  /*
+  * Forget the previous sample and the measured period.
+  */
+  void Reset() {
+    started_ = false;
+    intervals_ = 0;
+    period_ = 0;
+  }
+
+  /*
+  * Seconds since the previous call, or 0 on the first call.
+  */
+  double Tick() {
+    const std::chrono::steady_clock::time_point now =
+        std::chrono::steady_clock::now();
+    double dt = 0;
+    if (started_) {
+      dt = std::chrono::duration<double>(now - last_).count();
+    }
+    last_ = now;
+    started_ = true;
+    if (dt > 0 && intervals_ < kCalibrationSamples) {
+      calibration_[intervals_++] = dt;
+      if (intervals_ == kCalibrationSamples) {
+        std::nth_element(calibration_, calibration_ + kCalibrationSamples / 2,
+                         calibration_ + kCalibrationSamples);
+        period_ = calibration_[kCalibrationSamples / 2];
+      }
+    }
+    return dt;
+  }
+
+  /*
+  * True once the nominal period has been measured.
+  */
+  bool calibrated() const { return period_ > 0; }
+
+  /*
+  * The measured nominal period in seconds, 0 until calibrated().
+  */
+  double period() const { return period_; }
+
+ private:
+  std::chrono::steady_clock::time_point last_;
+  bool started_;
+  double calibration_[kCalibrationSamples];
+  int intervals_;
+  double period_;
+};
+
+#endif /* SAMPLE_CLOCK_H */
@@ -0,0 +1,113 @@
+// Times ScanFrame against a byte-at-a-time scan and checks that the two
+// report the same offsets.
+//
+// usage: pid_scan_frame_bench [iterations]
+//
+// The timed frames are short telemetry, telemetry carrying a 16 KB base64
+// camera image, and the manual-mode frame. Agreement is also checked on
+// random frames made of the structural bytes, with "null" straddling block
+// boundaries and brackets after it. Exits non-zero on any disagreement.
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "bench.h"
+#include "socketio.h"
+
+namespace {
+
+// ScanFrame's specification, one byte at a time.
+void ScalarScan(const char *data, size_t length, FrameScan *scan) {
+  scan->first_open = FrameScan::kNotFound;
+  scan->last_close = FrameScan::kNotFound;
+  scan->null_marker = FrameScan::kNotFound;
+  for (size_t i = 0; i < length; ++i) {
+    if (data[i] == '[' && scan->first_open == FrameScan::kNotFound) {
+      scan->first_open = i;
+    } else if (data[i] == ']') {
+      scan->last_close = i;
+    } else if (length - i >= 4 && std::memcmp(data + i, "null", 4) == 0) {
+      scan->null_marker = i;
+      return;
+    }
+  }
+}
+
+bool Agrees(const std::string &frame) {
+  FrameScan simd, scalar;
+  ScanFrame(frame.data(), frame.size(), &simd);
+  ScalarScan(frame.data(), frame.size(), &scalar);
+  return simd.first_open == scalar.first_open &&
+         simd.last_close == scalar.last_close &&
+         simd.null_marker == scalar.null_marker;
+}
+
+long RandomFrameMismatches(long frames) {
+  static const char kBytes[] = "[]nulx";
+  uint64_t state = 0x9E3779B97F4A7C15ULL;
+  long mismatches = 0;
+  for (long k = 0; k < frames; ++k) {
+    state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+    const size_t length = (state >> 33) % 160;
+    std::string frame;
+    for (size_t b = 0; b < length; ++b) {
+      state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+      frame += kBytes[(state >> 33) % 6];
+    }
+    // plant a "null" at a random offset, with brackets on both sides
+    if (length >= 8 && k % 2) {
+      frame.replace((state >> 40) % (length - 4), 4, "null");
+    }
+    if (!Agrees(frame) && ++mismatches <= 5) {
+      std::printf("mismatch on \"%s\"\n", frame.c_str());
+    }
+  }
+  return mismatches;
+}
+
+double Time(const std::vector<std::string> &frames, long iterations,
+            void (*scan)(const char *, size_t, FrameScan *)) {
+  const size_t n = frames.size();
+  return BestSeconds([&]() {
+    size_t sum = 0;
+    for (long k = 0; k < iterations; ++k) {
+      const std::string &frame = frames[k % n];
+      FrameScan result;
+      scan(frame.data(), frame.size(), &result);
+      sum += result.last_close;
+    }
+    Consume(sum);
+  }) * 1e9 / iterations;
+}
+
+// Returns false if the scans disagree on any of the frames.
+bool Compare(const char *name, const std::vector<std::string> &frames,
+             long iterations) {
+  bool agree = true;
+  for (size_t k = 0; k < frames.size(); ++k) {
+    agree &= Agrees(frames[k]);
+  }
+  const double simd_ns = Time(frames, iterations, ScanFrame);
+  const double scalar_ns = Time(frames, iterations, ScalarScan);
+  std::printf("%-22s ScanFrame %8.1f ns (%5.2f GB/s), scalar %8.1f ns%s\n",
+              name, simd_ns, frames[0].size() / simd_ns, scalar_ns,
+              agree ? "" : "  MISMATCH");
+  return agree;
+}
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+  const long iterations = Iterations(argc, argv, 1000000);
+
+  const SimulatorFrames frames;
+  bool ok = true;
+  ok &= Compare("telemetry", frames.telemetry, iterations);
+  ok &= Compare("telemetry, 16 KB image", frames.image, iterations / 100 + 1);
+  ok &= Compare("manual", frames.manual, iterations);
+  const long mismatches = RandomFrameMismatches(iterations / 10 + 1000);
+  std::printf("random frames: %ld mismatches\n", mismatches);
+  return ok && mismatches == 0 ? 0 : 1;
+}
@@ -0,0 +1,78 @@
+#ifndef SEQLOCK_H
+#define SEQLOCK_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+/*
+* Single-writer sequence lock for publishing a small trivially copyable value
+* (e.g. a gain set) to a real-time reader. The writer never waits for the
+* reader and the reader never waits for the writer: TryLoad() gives up
+* instead of retrying when it races with a Store(), and the caller simply
+* keeps its current value until the next poll.
+*
+* The payload is held in relaxed atomic words so concurrent reads and writes
+* are well defined.
+*/
+template <typename T>
+class Seqlock {
+  static_assert(std::is_trivially_copyable<T>::value,
+                "Seqlock payload must be trivially copyable");
+
+ public:
+  Seqlock() : seq_(0) {
+    for (size_t k = 0; k < kWords; ++k) {
+      words_[k].store(0, std::memory_order_relaxed);
+    }
+  }
+
+  /*
+  * Publish a new value. Only one thread may call Store().
+  */
+  void Store(const T &value) {
+    uint64_t buffer[kWords] = {};
+    std::memcpy(buffer, &value, sizeof(T));
+
+    const uint64_t seq = seq_.load(std::memory_order_relaxed);
+    seq_.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    for (size_t k = 0; k < kWords; ++k) {
+      words_[k].store(buffer[k], std::memory_order_relaxed);
+    }
+    seq_.store(seq + 2, std::memory_order_release);
+  }
+
+  /*
+  * Copy the latest value into out if one has been published since *version
+  * and could be read consistently, then update *version. Returns false,
+  * leaving out untouched, otherwise. Start with *version == 0.
+  */
+  bool TryLoad(T *out, uint64_t *version) const {
+    const uint64_t before = seq_.load(std::memory_order_acquire);
+    if (before == *version || (before & 1)) {
+      return false;
+    }
+    uint64_t buffer[kWords];
+    for (size_t k = 0; k < kWords; ++k) {
+      buffer[k] = words_[k].load(std::memory_order_relaxed);
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (seq_.load(std::memory_order_relaxed) != before) {
+      return false;
+    }
+    std::memcpy(out, buffer, sizeof(T));
+    *version = before;
+    return true;
+  }
+
+ private:
+  static const size_t kWords = (sizeof(T) + sizeof(uint64_t) - 1) /
+                               sizeof(uint64_t);
+
+  std::atomic<uint64_t> seq_;
+  std::atomic<uint64_t> words_[kWords];
+};
+
+#endif /* SEQLOCK_H */
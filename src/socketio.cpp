@@ -0,0 +1,336 @@
+#include "socketio.h"
+#include <math.h>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#include "number_parser.h"
+
+namespace {
+
+// Vector backend for ScanFrame: AVX2 when the build targets it, SSE2 on any
+// x86-64, otherwise the scalar loop alone.
+#if defined(__AVX2__)
+typedef __m256i Block;
+const size_t kBlockSize = 32;
+inline Block Load(const char *p) {
+  return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+}
+inline Block Splat(char c) { return _mm256_set1_epi8(c); }
+inline uint32_t Matches(Block b, Block c) {
+  return static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(b, c)));
+}
+#define PID_SIMD_SCAN
+#elif defined(__SSE2__)
+typedef __m128i Block;
+const size_t kBlockSize = 16;
+inline Block Load(const char *p) {
+  return _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+}
+inline Block Splat(char c) { return _mm_set1_epi8(c); }
+inline uint32_t Matches(Block b, Block c) {
+  return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(b, c)));
+}
+#define PID_SIMD_SCAN
+#endif
+
+}  // namespace
+
+void ScanFrame(const char *data, size_t length, FrameScan *scan) {
+  scan->first_open = FrameScan::kNotFound;
+  scan->last_close = FrameScan::kNotFound;
+  scan->null_marker = FrameScan::kNotFound;
+  size_t i = 0;
+
+#ifdef PID_SIMD_SCAN
+  const Block open = Splat('['), close = Splat(']');
+  const Block n = Splat('n'), u = Splat('u'), l = Splat('l');
+  // "null" is found by matching each of its letters at shifted offsets, so
+  // every block may also read the 3 bytes after it. the shifted loads are
+  // only done for blocks holding an 'n'
+  for (; i + kBlockSize + 3 <= length; i += kBlockSize) {
+    const char *p = data + i;
+    const Block b = Load(p);
+    uint32_t nulls = Matches(b, n);
+    if (nulls) {
+      nulls &= Matches(Load(p + 1), u) & Matches(Load(p + 2), l) &
+               Matches(Load(p + 3), l);
+    }
+    uint32_t opens = Matches(b, open);
+    uint32_t closes = Matches(b, close);
+    if (nulls) {
+      // drop the brackets after the "null", as the scalar scan never sees
+      // them
+      const uint32_t before = (1u << __builtin_ctz(nulls)) - 1;
+      opens &= before;
+      closes &= before;
+    }
+    if (opens && scan->first_open == FrameScan::kNotFound) {
+      scan->first_open = i + __builtin_ctz(opens);
+    }
+    if (closes) {
+      scan->last_close = i + 31 - __builtin_clz(closes);
+    }
+    if (nulls) {
+      scan->null_marker = i + __builtin_ctz(nulls);
+      return;
+    }
+  }
+#endif
+
+  for (; i < length; ++i) {
+    switch (data[i]) {
+      case '[':
+        if (scan->first_open == FrameScan::kNotFound) {
+          scan->first_open = i;
+        }
+        break;
+      case ']':
+        scan->last_close = i;
+        break;
+      case 'n':
+        if (length - i >= 4 && std::memcmp(data + i, "null", 4) == 0) {
+          scan->null_marker = i;
+          return;
+        }
+        break;
+    }
+  }
+}
+
+bool ExtractPayload(const char *data, size_t length, Slice *payload) {
+  FrameScan scan;
+  ScanFrame(data, length, &scan);
+  if (scan.null_marker != FrameScan::kNotFound ||
+      scan.first_open == FrameScan::kNotFound ||
+      scan.last_close == FrameScan::kNotFound ||
+      scan.last_close < scan.first_open) {
+    return false;
+  }
+  payload->data = data + scan.first_open;
+  payload->size = scan.last_close - scan.first_open + 1;
+  return true;
+}
+
+FrameType ClassifyFrame(const char *data, size_t length, Slice *payload) {
+  static const char kTelemetryPrefix[] = "42[\"telemetry\",";
+  const size_t prefix_length = sizeof(kTelemetryPrefix) - 1;
+  if (length <= 2 || data[0] != '4' || data[1] != '2') {
+    return kNotEventFrame;
+  }
+  if (length > prefix_length + 4 &&
+      std::memcmp(data, kTelemetryPrefix, prefix_length) == 0) {
+    const char *value = data + prefix_length;
+    if (value[0] == '{') {
+      payload->data = data + 2;
+      payload->size = length - 2;
+      return kTelemetryFrame;
+    }
+    if (std::memcmp(value, "null", 4) == 0) {
+      return kManualFrame;
+    }
+  }
+  Slice event;
+  if (!ExtractPayload(data, length, payload)) {
+    return kManualFrame;
+  }
+  if (ParseEventName(*payload, &event) && event.Equals("telemetry")) {
+    return kTelemetryFrame;
+  }
+  return kOtherEventFrame;
+}
+
+namespace {
+
+const char *SkipSpace(const char *p, const char *end) {
+  while (p != end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')) {
+    ++p;
+  }
+  return p;
+}
+
+// p points at an opening quote. Stores the contents in *contents and returns
+// the position after the closing quote, or NULL if the string is unterminated.
+const char *ScanString(const char *p, const char *end, Slice *contents) {
+  const char *start = ++p;
+  while (p != end && *p != '"') {
+    if (*p == '\\') {
+      if (++p == end) {
+        return NULL;
+      }
+    }
+    ++p;
+  }
+  if (p == end) {
+    return NULL;
+  }
+  contents->data = start;
+  contents->size = p - start;
+  return p + 1;
+}
+
+// Scans a string, number or literal value. Returns NULL for objects and
+// arrays, which telemetry fields never hold.
+const char *ScanValue(const char *p, const char *end, Slice *value) {
+  if (p == end || *p == '{' || *p == '[') {
+    return NULL;
+  }
+  if (*p == '"') {
+    return ScanString(p, end, value);
+  }
+  const char *start = p;
+  while (p != end && *p != ',' && *p != '}' && *p != ' ' && *p != '\t' &&
+         *p != '\n' && *p != '\r') {
+    ++p;
+  }
+  value->data = start;
+  value->size = p - start;
+  return p;
+}
+
+bool ParseNumber(Slice text, double *value) {
+  return ParseDouble(text.begin(), text.end(), value);
+}
+
+// Appends text to out[*size, capacity). Returns false if it doesn't fit.
+bool Append(const char *text, size_t length, char *out, size_t capacity,
+            size_t *size) {
+  if (capacity - *size < length) {
+    return false;
+  }
+  std::memcpy(out + *size, text, length);
+  *size += length;
+  return true;
+}
+
+// Appends x the way nlohmann::json::dump() writes a double.
+bool AppendNumber(double x, char *out, size_t capacity, size_t *size) {
+  if (!isfinite(x)) {
+    return Append("null", 4, out, capacity, size);
+  }
+  if (x == 0) {
+    return signbit(x) ? Append("-0.0", 4, out, capacity, size)
+                      : Append("0.0", 3, out, capacity, size);
+  }
+  char *start = out + *size;
+  const size_t room = capacity - *size;
+  const int written = std::snprintf(start, room, "%.15g", x);
+  if (written <= 0 || static_cast<size_t>(written) >= room) {
+    return false;
+  }
+  *size += written;
+  for (int k = 0; k < written; ++k) {
+    if (start[k] == '.' || start[k] == 'e' || start[k] == 'E') {
+      return true;
+    }
+  }
+  return Append(".0", 2, out, capacity, size);
+}
+
+}  // namespace
+
+bool ParseEventName(Slice payload, Slice *name) {
+  const char *end = payload.end();
+  const char *p = SkipSpace(payload.begin(), end);
+  if (p == end || *p != '[') {
+    return false;
+  }
+  p = SkipSpace(p + 1, end);
+  return p != end && *p == '"' && ScanString(p, end, name) != NULL;
+}
+
+DecodeStatus DecodeTelemetry(Slice payload, Telemetry *t) {
+  const char *end = payload.end();
+  const char *p = SkipSpace(payload.begin(), end);
+  if (p == end || *p != '[') {
+    return kDecodeMalformed;
+  }
+  p = SkipSpace(p + 1, end);
+  Slice event;
+  if (p == end || *p != '"' || !(p = ScanString(p, end, &event)) ||
+      !event.Equals("telemetry")) {
+    return kDecodeMalformed;
+  }
+  p = SkipSpace(p, end);
+  if (p == end || *p != ',') {
+    return kDecodeMalformed;
+  }
+  p = SkipSpace(p + 1, end);
+  if (p == end || *p != '{') {
+    return kDecodeMalformed;
+  }
+
+  const int kCte = 1, kSpeed = 2, kAngle = 4, kAll = 7;
+  int found = 0;
+  Telemetry decoded = *t;
+  p = SkipSpace(p + 1, end);
+  if (p != end && *p == '}') {
+    return kDecodeMissingField;
+  }
+  while (true) {
+    Slice key, value;
+    if (p == end || *p != '"' || !(p = ScanString(p, end, &key))) {
+      return kDecodeMalformed;
+    }
+    p = SkipSpace(p, end);
+    if (p == end || *p != ':') {
+      return kDecodeMalformed;
+    }
+    p = SkipSpace(p + 1, end);
+    if (!(p = ScanValue(p, end, &value))) {
+      return kDecodeMalformed;
+    }
+
+    double *field = NULL;
+    if (key.Equals("cte")) {
+      field = &decoded.cte;
+      found |= kCte;
+    } else if (key.Equals("speed")) {
+      field = &decoded.speed;
+      found |= kSpeed;
+    } else if (key.Equals("steering_angle")) {
+      field = &decoded.angle;
+      found |= kAngle;
+    }
+    if (field) {
+      if (!ParseNumber(value, field)) {
+        return kDecodeMalformed;
+      }
+      if (!isfinite(*field)) {
+        return kDecodeOutOfRange;
+      }
+    }
+    if (found == kAll) {
+      *t = decoded;
+      return kDecodeOk;
+    }
+
+    p = SkipSpace(p, end);
+    if (p != end && *p == '}') {
+      return kDecodeMissingField;
+    }
+    if (p == end || *p != ',') {
+      return kDecodeMalformed;
+    }
+    p = SkipSpace(p + 1, end);
+  }
+}
+
+size_t WriteSteerReply(const Command &c, char *out, size_t capacity) {
+  static const char kPrefix[] = "42[\"steer\",{\"steering_angle\":";
+  static const char kThrottle[] = ",\"throttle\":";
+  static const char kSuffix[] = "}]";
+  size_t size = 0;
+  if (!Append(kPrefix, sizeof(kPrefix) - 1, out, capacity, &size) ||
+      !AppendNumber(c.steering_angle, out, capacity, &size) ||
+      !Append(kThrottle, sizeof(kThrottle) - 1, out, capacity, &size) ||
+      !AppendNumber(c.throttle, out, capacity, &size) ||
+      !Append(kSuffix, sizeof(kSuffix) - 1, out, capacity, &size)) {
+    return 0;
+  }
+  return size;
+}
@@ -0,0 +1,106 @@
+#ifndef SOCKETIO_H
+#define SOCKETIO_H
+
+#include <cstddef>
+#include <cstring>
+#include "telemetry.h"
+
+/*
+* Non-owning view of bytes inside a received websocket frame.
+*/
+struct Slice {
+  const char *data;
+  size_t size;
+
+  const char *begin() const { return data; }
+  const char *end() const { return data + size; }
+
+  bool Equals(const char *literal) const {
+    return std::strlen(literal) == size &&
+           std::memcmp(data, literal, size) == 0;
+  }
+};
+
+/*
+* Kind of socket.io frame, as far as the controller is concerned.
+*/
+enum FrameType {
+  // not a "42" event frame
+  kNotEventFrame,
+  // telemetry with data to control on
+  kTelemetryFrame,
+  // event without data: the simulator is in manual mode
+  kManualFrame,
+  // any other event
+  kOtherEventFrame,
+};
+
+/*
+* Canned reply to manual-mode frames.
+*/
+const char kManualReply[] = "42[\"manual\",{}]";
+
+/*
+* Classify a frame. The stock simulator's telemetry and manual frames are
+* recognized from their fixed prefix in constant time; other frames, e.g.
+* ones addressed to a namespace like 42/sim,[...], fall back to
+* ExtractPayload and ParseEventName. For telemetry and other events,
+* *payload is set to the JSON payload to decode. Doesn't allocate.
+*/
+FrameType ClassifyFrame(const char *data, size_t length, Slice *payload);
+
+/*
+* Offsets of the structural bytes of a frame.
+*/
+struct FrameScan {
+  static const size_t kNotFound = static_cast<size_t>(-1);
+
+  // first '['
+  size_t first_open;
+  // last ']'
+  size_t last_close;
+  // first "null". when set, the scan stopped there and the other offsets
+  // only cover the bytes before it
+  size_t null_marker;
+};
+
+/*
+* Find the structural bytes of data[0, length) in one pass, 16 or 32 bytes
+* at a time with SSE2 or AVX2 where available. The scan stops at the first
+* "null"; offsets not found are FrameScan::kNotFound.
+*/
+void ScanFrame(const char *data, size_t length, FrameScan *scan);
+
+/*
+* Locate the JSON payload of a socket.io event frame, i.e. the bytes from the
+* first '[' to the last ']' of data[0, length). Returns false when there is
+* no payload or the frame contains "null" (the simulator is in manual mode).
+* Uses ScanFrame, so it never reads past length and doesn't allocate.
+*/
+bool ExtractPayload(const char *data, size_t length, Slice *payload);
+
+/*
+* Extract the event name of a payload ["name", ...], without its quotes.
+*/
+bool ParseEventName(Slice payload, Slice *name);
+
+/*
+* Decode the cte, speed and steering_angle fields of a
+* ["telemetry", {...}] payload in a single scan of the receive buffer,
+* stopping as soon as all three are found so trailing fields such as the
+* camera image are never touched. Fields may appear in any order and as
+* quoted or bare numbers. dt is left untouched, and so are fields when the
+* status isn't kDecodeOk. Never throws and doesn't allocate.
+*/
+DecodeStatus DecodeTelemetry(Slice payload, Telemetry *t);
+
+/*
+* Serialize c as the socket.io frame 42["steer",{...}] into out, returning
+* its length, or 0 if capacity is too small (128 bytes always suffices).
+* The output is byte-for-byte what building the reply with nlohmann::json
+* and dump() produced, including its "%.15g" number format, ".0" suffix on
+* integral values and null for non-finite ones. Doesn't allocate.
+*/
+size_t WriteSteerReply(const Command &c, char *out, size_t capacity);
+
+#endif /* SOCKETIO_H */
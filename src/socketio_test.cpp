@@ -0,0 +1,152 @@
+// Checks the socket.io text path: that every telemetry frame ClassifyFrame
+// recognizes decodes from the payload it returns, and that WriteSteerReply
+// writes exactly the frame the nlohmann::json reply it replaced did.
+//
+// usage: pid_socketio_test
+//
+// Exits non-zero if any check fails.
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <string>
+#include "json.hpp"
+#include "socketio.h"
+
+using json = nlohmann::json;
+
+namespace {
+
+bool Check(bool ok, const std::string &name) {
+  std::printf("%-60s %s\n", name.c_str(), ok ? "ok" : "FAILED");
+  return ok;
+}
+
+// Classifies frame and decodes its telemetry as the server does.
+bool DecodesTelemetry(const char *frame, double cte) {
+  Slice payload;
+  Telemetry t = Telemetry();
+  return ClassifyFrame(frame, std::strlen(frame), &payload) ==
+             kTelemetryFrame &&
+         DecodeTelemetry(payload, &t) == kDecodeOk && t.cte == cte &&
+         t.speed == 30.5 && t.angle == -2.25;
+}
+
+bool ClassifiedAs(const char *frame, FrameType type) {
+  Slice payload;
+  return ClassifyFrame(frame, std::strlen(frame), &payload) == type;
+}
+
+bool ClassifyAndDecode() {
+  bool ok = true;
+  // the stock simulator's frame, on the fixed-prefix fast path
+  ok &= Check(DecodesTelemetry("42[\"telemetry\",{\"cte\":\"0.7598\","
+                               "\"speed\":\"30.5\",\"steering_angle\":"
+                               "\"-2.25\",\"throttle\":\"0.3\"}]",
+                               0.7598),
+              "prefix fast path decodes");
+  // frames only the ExtractPayload fallback recognizes
+  ok &= Check(DecodesTelemetry("42/sim,[\"telemetry\",{\"cte\":1.5,"
+                               "\"speed\":30.5,\"steering_angle\":-2.25}]",
+                               1.5),
+              "namespaced frame decodes");
+  ok &= Check(DecodesTelemetry("42/sim,17[\"telemetry\",{\"cte\":-1,"
+                               "\"speed\":30.5,\"steering_angle\":-2.25}]",
+                               -1),
+              "namespaced frame with an ack id decodes");
+  ok &= Check(DecodesTelemetry("42[ \"telemetry\" , {\"steering_angle\":"
+                               "-2.25,\"speed\":30.5,\"cte\":0}]",
+                               0),
+              "spaced frame decodes");
+  ok &= Check(ClassifiedAs("42[\"telemetry\",null]", kManualFrame),
+              "manual frame");
+  ok &= Check(ClassifiedAs("42/sim,[\"telemetry\",null]", kManualFrame),
+              "namespaced manual frame");
+  ok &= Check(ClassifiedAs("42[\"reset\",{}]", kOtherEventFrame),
+              "other event");
+  ok &= Check(ClassifiedAs("3probe", kNotEventFrame), "not an event");
+  return ok;
+}
+
+// The reply as main.cpp built it before WriteSteerReply.
+std::string JsonReply(const Command &c) {
+  json msg;
+  msg["steering_angle"] = c.steering_angle;
+  msg["throttle"] = c.throttle;
+  return "42[\"steer\"," + msg.dump() + "]";
+}
+
+bool ReplyMatchesJson(double steering_angle, double throttle) {
+  Command c;
+  c.steering_angle = steering_angle;
+  c.throttle = throttle;
+  char reply[128];
+  const size_t length = WriteSteerReply(c, reply, sizeof(reply));
+  const std::string expected = JsonReply(c);
+  if (length != 0 && expected == std::string(reply, length)) {
+    return true;
+  }
+  std::printf("  %.17g, %.17g: wrote \"%.*s\", json \"%s\"\n", steering_angle,
+              throttle, static_cast<int>(length), reply, expected.c_str());
+  return false;
+}
+
+bool ReplyMatchesJson(double value) {
+  return ReplyMatchesJson(value, 0.3) && ReplyMatchesJson(-0.25, value) &&
+         ReplyMatchesJson(value, value);
+}
+
+bool SteerReplies() {
+  const double kInf = std::numeric_limits<double>::infinity();
+  const double kDenormMin = std::numeric_limits<double>::denorm_min();
+  bool ok = true;
+  ok &= Check(ReplyMatchesJson(0.0) && ReplyMatchesJson(-0.0), "reply: zero");
+  ok &= Check(ReplyMatchesJson(1.0) && ReplyMatchesJson(-1.0) &&
+                  ReplyMatchesJson(25.0) && ReplyMatchesJson(-3e15) &&
+                  ReplyMatchesJson(9007199254740992.0),
+              "reply: integers");
+  ok &= Check(ReplyMatchesJson(1e20) && ReplyMatchesJson(-1e20) &&
+                  ReplyMatchesJson(1e300) && ReplyMatchesJson(
+                      std::numeric_limits<double>::max()),
+              "reply: large magnitudes");
+  ok &= Check(ReplyMatchesJson(kDenormMin) && ReplyMatchesJson(-kDenormMin) &&
+                  ReplyMatchesJson(std::numeric_limits<double>::min() / 3) &&
+                  ReplyMatchesJson(std::numeric_limits<double>::min()),
+              "reply: denormals");
+  ok &= Check(ReplyMatchesJson(std::nan("")) && ReplyMatchesJson(kInf) &&
+                  ReplyMatchesJson(-kInf),
+              "reply: non-finite");
+  ok &= Check(ReplyMatchesJson(0.1) && ReplyMatchesJson(-0.123456789012345) &&
+                  ReplyMatchesJson(1.0 / 3) && ReplyMatchesJson(1e-5) &&
+                  ReplyMatchesJson(123456789.125),
+              "reply: fractions");
+
+  // controller-range outputs, then arbitrary bit patterns
+  uint64_t state = 0x9E3779B97F4A7C15ULL;
+  long mismatches = 0;
+  for (long k = 0; k < 200000; ++k) {
+    state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+    double value;
+    if (k % 2) {
+      std::memcpy(&value, &state, sizeof(value));
+    } else {
+      value = std::ldexp(static_cast<double>(state >> 11), -52) - 1.0;
+    }
+    if (!ReplyMatchesJson(value, -value) && ++mismatches >= 5) {
+      break;
+    }
+  }
+  ok &= Check(mismatches == 0, "reply: random sweep");
+  return ok;
+}
+
+}  // namespace
+
+int main() {
+  bool ok = true;
+  ok &= ClassifyAndDecode();
+  ok &= SteerReplies();
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,76 @@
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <atomic>
+#include <cstddef>
+#include <type_traits>
+
+/*
+* Bounded lock-free queue for exactly one producer thread and one consumer
+* thread. Neither side ever waits: TryPush() fails when the ring is full and
+* TryPop() fails when it is empty. Capacity must be a power of two.
+*
+* Each side keeps its own index and a cached copy of the other side's on
+* separate cache lines, so the shared indices are only re-read when the
+* cached copy says the ring looks full (or empty).
+*/
+template <typename T, size_t Capacity>
+class SpscRing {
+  static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0,
+                "SpscRing capacity must be a power of two");
+  static_assert(std::is_trivially_copyable<T>::value,
+                "SpscRing elements must be trivially copyable");
+
+ public:
+  SpscRing() : head_(0), cached_tail_(0), tail_(0), cached_head_(0) {}
+
+  /*
+  * Append value. Returns false, dropping it, if the ring is full. Producer
+  * thread only.
+  */
+  bool TryPush(const T &value) {
+    const size_t head = head_.load(std::memory_order_relaxed);
+    if (head - cached_tail_ == Capacity) {
+      cached_tail_ = tail_.load(std::memory_order_acquire);
+      if (head - cached_tail_ == Capacity) {
+        return false;
+      }
+    }
+    slots_[head & (Capacity - 1)] = value;
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  /*
+  * Remove the oldest value into out. Returns false, leaving out untouched,
+  * if the ring is empty. Consumer thread only.
+  */
+  bool TryPop(T *out) {
+    const size_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail == cached_head_) {
+      cached_head_ = head_.load(std::memory_order_acquire);
+      if (tail == cached_head_) {
+        return false;
+      }
+    }
+    *out = slots_[tail & (Capacity - 1)];
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+ private:
+  SpscRing(const SpscRing &);
+  SpscRing &operator=(const SpscRing &);
+
+  // producer side
+  alignas(64) std::atomic<size_t> head_;
+  size_t cached_tail_;
+
+  // consumer side
+  alignas(64) std::atomic<size_t> tail_;
+  size_t cached_head_;
+
+  alignas(64) T slots_[Capacity];
+};
+
+#endif /* SPSC_RING_H */
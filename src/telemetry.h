@@ -0,0 +1,61 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <cstdint>
+
+/*
+* One telemetry sample as received from the simulator.
+*/
+struct Telemetry {
+  double cte;
+  double speed;
+  // steering angle in degrees
+  double angle;
+  // seconds since the previous sample, 0 if unknown
+  double dt;
+};
+
+/*
+* Result of decoding a telemetry frame, in either protocol.
+*/
+enum DecodeStatus {
+  kDecodeOk,
+  // not a well-formed telemetry frame, or a field isn't a number
+  kDecodeMalformed,
+  // the frame ended before cte, speed and steering_angle were all seen
+  kDecodeMissingField,
+  // a field is infinite or NaN
+  kDecodeOutOfRange,
+};
+
+/*
+* Actuator command sent back to the simulator.
+*/
+struct Command {
+  double steering_angle;
+  double throttle;
+};
+
+/*
+* One row of controller state after a control step, as recorded by
+* TelemetryRecorder.
+*/
+struct TelemetryRecord {
+  // wall-clock time of the step, nanoseconds since the Unix epoch
+  int64_t timestamp;
+  double cte;
+  double speed;
+  double angle;
+  // the command sent
+  double steering_angle;
+  double throttle;
+  // the steering pid's d_error and i_error
+  double delta_cte;
+  double total_cte;
+  // Kp * cte, Ki * total_cte and Kd * delta_cte
+  double p_contrib;
+  double i_contrib;
+  double d_contrib;
+};
+
+#endif /* TELEMETRY_H */
@@ -0,0 +1,209 @@
+#include "telemetry_recorder.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cstdio>
+#include <cstring>
+
+namespace {
+
+const char kTextHeader[] =
+    "cte delta_cte total_cte p_contrib d_contrib i_contrib speed\n";
+
+// rows are written at least this often while the car is driving
+const std::chrono::milliseconds kFlushInterval(1000);
+
+}  // namespace
+
+TelemetryRecorder::TelemetryRecorder(const std::string &path,
+                                     RecordFormat format, uint64_t max_bytes,
+                                     double max_seconds)
+    : path_(path), format_(format), max_bytes_(max_bytes),
+      max_seconds_(max_seconds), fd_(-1), file_bytes_(0), header_bytes_(0),
+      rotations_(0), rotating_(true), buffered_rows_(0), dropped_(0),
+      lost_rows_(0), lost_bytes_(0), stop_(false) {
+  buffer_.reserve(kBufferSize);
+  // a previous session's file is rotated away like a full one, never
+  // truncated
+  struct stat st;
+  if (stat(path_.c_str(), &st) == 0 && st.st_size > 0) {
+    const std::string rotated = NextRotatedPath();
+    if (rename(path_.c_str(), rotated.c_str()) != 0) {
+      fprintf(stderr, "cannot move %s aside to %s: %s; not recording\n",
+              path_.c_str(), rotated.c_str(), strerror(errno));
+      thread_ = std::thread(&TelemetryRecorder::Run, this);
+      return;
+    }
+  }
+  Open();
+  thread_ = std::thread(&TelemetryRecorder::Run, this);
+}
+
+TelemetryRecorder::~TelemetryRecorder() {
+  stop_.store(true, std::memory_order_release);
+  thread_.join();
+  Finish();
+}
+
+void TelemetryRecorder::Open() {
+  fd_ = open(path_.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  file_bytes_ = 0;
+  opened_ = std::chrono::steady_clock::now();
+  block_offsets_.clear();
+  if (fd_ < 0) {
+    return;
+  }
+  if (format_ != kTextRecords) {
+    AppendColumnarHeader(&buffer_);
+  } else {
+    buffer_.insert(buffer_.end(), kTextHeader,
+                   kTextHeader + sizeof(kTextHeader) - 1);
+  }
+  header_bytes_ = buffer_.size();
+}
+
+void TelemetryRecorder::Finish() {
+  if (fd_ < 0) {
+    return;
+  }
+  Flush();
+  if (format_ != kTextRecords) {
+    AppendColumnarIndex(block_offsets_, file_bytes_, &buffer_);
+    Flush();
+  }
+  close(fd_);
+  fd_ = -1;
+}
+
+void TelemetryRecorder::Run() {
+  std::chrono::steady_clock::time_point last_flush =
+      std::chrono::steady_clock::now();
+  while (true) {
+    // read stop_ before draining so nothing recorded before the destructor
+    // ran is left behind
+    const bool stopping = stop_.load(std::memory_order_acquire);
+    TelemetryRecord record;
+    bool drained = false;
+    while (ring_.TryPop(&record)) {
+      Append(record);
+      drained = true;
+    }
+    if (stopping) {
+      break;
+    }
+    const std::chrono::steady_clock::time_point now =
+        std::chrono::steady_clock::now();
+    if (now - last_flush >= kFlushInterval) {
+      Flush();
+      RotateIfDue();
+      last_flush = now;
+    }
+    if (!drained) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+  }
+}
+
+void TelemetryRecorder::Append(const TelemetryRecord &record) {
+  if (fd_ < 0) {
+    return;
+  }
+  if (format_ != kTextRecords) {
+    block_.Add(record);
+    if (block_.rows() == kColumnarMaxBlockRows) {
+      Flush();
+    }
+  } else {
+    AppendText(record);
+  }
+  if (max_bytes_ && rotating_ &&
+      file_bytes_ + buffer_.size() + block_.rows() * 8 * kColumnCount >=
+          max_bytes_) {
+    Flush();
+    RotateIfDue();
+  }
+}
+
+void TelemetryRecorder::AppendText(const TelemetryRecord &record) {
+  char row[256];
+  const int length = snprintf(row, sizeof(row), "%g %g %g %g %g %g %g\n",
+                              record.cte, record.delta_cte, record.total_cte,
+                              record.p_contrib, record.d_contrib,
+                              record.i_contrib, record.speed);
+  if (length <= 0) {
+    return;
+  }
+  if (buffer_.size() + length > kBufferSize) {
+    Flush();
+  }
+  buffer_.insert(buffer_.end(), row, row + length);
+  ++buffered_rows_;
+}
+
+void TelemetryRecorder::Flush() {
+  if (block_.rows()) {
+    block_offsets_.push_back(file_bytes_ + buffer_.size());
+    buffered_rows_ += block_.rows();
+    block_.Flush(&buffer_, format_ == kDeflatedColumnarRecords ? &deflater_
+                                                               : NULL);
+  }
+  size_t written = 0;
+  while (fd_ >= 0 && written < buffer_.size()) {
+    const ssize_t n = write(fd_, buffer_.data() + written,
+                            buffer_.size() - written);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      break;
+    }
+    written += n;
+  }
+  if (written < buffer_.size()) {
+    // only the recorder thread writes these, so a plain add is enough
+    lost_rows_.store(lost_rows_.load(std::memory_order_relaxed) +
+                         buffered_rows_,
+                     std::memory_order_relaxed);
+    lost_bytes_.store(lost_bytes_.load(std::memory_order_relaxed) +
+                          buffer_.size() - written,
+                      std::memory_order_relaxed);
+  }
+  file_bytes_ += written;
+  buffer_.clear();
+  buffered_rows_ = 0;
+}
+
+void TelemetryRecorder::RotateIfDue() {
+  // a file holding nothing but its header is never rotated away
+  if (!rotating_ || fd_ < 0 || file_bytes_ <= header_bytes_) {
+    return;
+  }
+  const bool too_big = max_bytes_ && file_bytes_ >= max_bytes_;
+  const bool too_old =
+      max_seconds_ > 0 &&
+      std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                    opened_).count() >= max_seconds_;
+  if (!too_big && !too_old) {
+    return;
+  }
+  // renamed while still open, so if that fails the file is left as it is
+  // and simply keeps growing
+  const std::string rotated = NextRotatedPath();
+  if (rename(path_.c_str(), rotated.c_str()) != 0) {
+    fprintf(stderr, "cannot rotate %s to %s: %s; rotation disabled\n",
+            path_.c_str(), rotated.c_str(), strerror(errno));
+    rotating_ = false;
+    return;
+  }
+  Finish();
+  Open();
+}
+
+std::string TelemetryRecorder::NextRotatedPath() {
+  std::string rotated;
+  do {
+    rotated = path_ + "." + std::to_string(++rotations_);
+  } while (access(rotated.c_str(), F_OK) == 0);
+  return rotated;
+}
@@ -0,0 +1,129 @@
+#ifndef TELEMETRY_RECORDER_H
+#define TELEMETRY_RECORDER_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+#include "columnar_log.h"
+#include "spsc_ring.h"
+#include "telemetry.h"
+
+/*
+* File formats TelemetryRecorder can write.
+*/
+enum RecordFormat {
+  // space-separated cte delta_cte total_cte p_contrib d_contrib i_contrib
+  // speed, one row per line
+  kTextRecords,
+  // every TelemetryRecord column but delta_cte and total_cte, in the
+  // columnar block format of columnar_log.h
+  kColumnarRecords,
+  // the columnar format with every block deflated
+  kDeflatedColumnarRecords,
+};
+
+/*
+* Records controller state to a file, one row per control step, without
+* doing any I/O on the control thread. Record() copies the row into a
+* lock-free ring; a background thread encodes the rows into a large buffer
+* and writes it out when it fills or once per flush interval. In the
+* columnar formats each flush ends the current block, and deflating happens
+* on the recorder thread too.
+*
+* The file is opened once. When it grows past max_bytes or has been open for
+* max_seconds (0 disables either limit) it is renamed to <path>.N, N being
+* the first unused suffix, finished (the columnar index is written) and a
+* fresh file is started at path. A non-empty file already at path when the
+* recorder starts is renamed the same way first. Nothing is truncated: if a
+* rotation fails, rotation stops and the current file keeps growing, and if
+* the old file can't be moved aside at startup, nothing is recorded. Rows that don't fit in the ring are dropped and counted,
+* and so are rows lost to a failed write; interrupted writes are retried.
+*
+* Record() must only be called from one thread.
+*/
+class TelemetryRecorder {
+ public:
+  TelemetryRecorder(const std::string &path, RecordFormat format,
+                    uint64_t max_bytes, double max_seconds);
+  ~TelemetryRecorder();
+
+  /*
+  * False if the file couldn't be opened, or an old one at its path couldn't
+  * be moved aside; rows are then discarded.
+  */
+  bool is_open() const { return fd_ >= 0; }
+
+  void Record(const TelemetryRecord &record) {
+    if (!ring_.TryPush(record)) {
+      dropped_.store(dropped_.load(std::memory_order_relaxed) + 1,
+                     std::memory_order_relaxed);
+    }
+  }
+
+  /*
+  * Rows dropped so far because the ring was full.
+  */
+  uint64_t dropped() const {
+    return dropped_.load(std::memory_order_relaxed);
+  }
+
+  /*
+  * Rows and bytes lost so far because writing the file failed. A row
+  * counts as lost when the write of the buffer holding it stopped short.
+  */
+  uint64_t lost_rows() const {
+    return lost_rows_.load(std::memory_order_relaxed);
+  }
+  uint64_t lost_bytes() const {
+    return lost_bytes_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  TelemetryRecorder(const TelemetryRecorder &);
+  TelemetryRecorder &operator=(const TelemetryRecorder &);
+
+  static const size_t kCapacity = 8192;
+  static const size_t kBufferSize = 1 << 20;
+
+  void Run();
+  void Open();
+  void Finish();
+  void Append(const TelemetryRecord &record);
+  void AppendText(const TelemetryRecord &record);
+  void Flush();
+  void RotateIfDue();
+  std::string NextRotatedPath();
+
+  std::string path_;
+  RecordFormat format_;
+  uint64_t max_bytes_;
+  double max_seconds_;
+
+  // owned by the recorder thread after construction
+  int fd_;
+  uint64_t file_bytes_;
+  uint64_t header_bytes_;
+  // the highest suffix tried so far
+  unsigned rotations_;
+  // false once a rename has failed
+  bool rotating_;
+  std::chrono::steady_clock::time_point opened_;
+  std::vector<char> buffer_;
+  // rows encoded into buffer_ since it was last written out
+  uint64_t buffered_rows_;
+  ColumnarBlockBuilder block_;
+  ColumnarDeflater deflater_;
+  std::vector<uint64_t> block_offsets_;
+
+  SpscRing<TelemetryRecord, kCapacity> ring_;
+  std::atomic<uint64_t> dropped_;
+  std::atomic<uint64_t> lost_rows_;
+  std::atomic<uint64_t> lost_bytes_;
+  std::atomic<bool> stop_;
+  std::thread thread_;
+};
+
+#endif /* TELEMETRY_RECORDER_H */